@@ -0,0 +1,10 @@
+#!/bin/sh
+
+CXX=${CXX:-g++}
+CXXFLAGS="-O2 -g -Wall -maes -msse4 -mpclmul"
+
+$CXX $CXXFLAGS -I../src -o transpose transpose.cpp \
+    ../src/transpose.cpp ../src/cpu.cpp ../src/utils.cpp
+$CXX $CXXFLAGS -I../src -o ghash ghash.cpp \
+    ../src/ghash.cpp ../src/cpu.cpp ../src/threadpool.cpp ../src/utils.cpp \
+    ../src/gfmul.s -lpthread
@@ -0,0 +1,174 @@
+/*
+ * Checks the GHASH engine against a Horner loop over gfmul: ghash() and
+ * ghash_update() fed in random splits must agree with it for every length up
+ * to MAXLEN, and ghash_parallel() must agree with ghash() for pools of
+ * 0, 1, 3 and 8 threads on lengths around the part sizes.  The checks run
+ * twice, in child processes, with CPU_ENV unset
+ * and set to 0, so that both the 512-bit PCLMULQDQ kernels (where the CPU has
+ * them) and the baseline ones are covered.
+ */
+#include "cpu.h"
+#include "ghash.h"
+#include "threadpool.h"
+#include "utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define MAXLEN 59
+#define NSPLITS 20
+
+static __m128i
+random_block(void)
+{
+    unsigned char buf[16];
+
+    for (int i = 0; i < 16; ++i)
+        buf[i] = (unsigned char) rand();
+    return _mm_loadu_si128((__m128i *) buf);
+}
+
+static __m128i
+horner(__m128i k, const __m128i *msg, int len)
+{
+    __m128i res = _mm_setzero_si128();
+
+    for (int i = 0; i < len; ++i)
+        gfmul(_mm_xor_si128(res, msg[i]), k, &res);
+    return res;
+}
+
+static int
+equal(__m128i a, __m128i b)
+{
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) == 0xffff;
+}
+
+static int
+check_streaming(void)
+{
+    __m128i msg[MAXLEN], k, res;
+    struct ghash_key key;
+    int bad = 0;
+
+    for (int len = 0; len <= MAXLEN; ++len) {
+        __m128i expected;
+
+        k = random_block();
+        for (int i = 0; i < len; ++i)
+            msg[i] = random_block();
+        expected = horner(k, msg, len);
+
+        ghash(k, msg, len, &res);
+        if (!equal(res, expected)) {
+            fprintf(stderr, "ghash: mismatch for length %d\n", len);
+            ++bad;
+        }
+
+        ghash_init_key(&key, k);
+        for (int s = 0; s < NSPLITS; ++s) {
+            struct ghash_ctx ctx;
+
+            ghash_init(&ctx, &key);
+            for (int off = 0; off < len;) {
+                int n = rand() % (len - off + 1);
+
+                ghash_update(&ctx, msg + off, n);
+                off += n;
+            }
+            ghash_final(&ctx, &res);
+            if (!equal(res, expected)) {
+                fprintf(stderr, "ghash_update: mismatch for length %d\n",
+                        len);
+                ++bad;
+                break;
+            }
+        }
+    }
+    return bad;
+}
+
+static int
+check_parallel(void)
+{
+    static const unsigned int nthreads[] = { 0, 1, 3, 8 };
+    static const size_t lens[] = { 0, 1, 4095, 4096, 8193, 12288 + 7, 40000 };
+    const size_t maxlen = lens[sizeof lens / sizeof lens[0] - 1];
+    __m128i *msg, k, expected, res;
+    int bad = 0;
+
+    msg = (__m128i *) ot_malloc(maxlen * sizeof(__m128i));
+    if (msg == NULL)
+        return 1;
+    for (size_t i = 0; i < maxlen; ++i)
+        msg[i] = random_block();
+    k = random_block();
+
+    for (size_t t = 0; t < sizeof nthreads / sizeof nthreads[0]; ++t) {
+        struct threadpool *pool = threadpool_create(nthreads[t]);
+
+        if (pool == NULL) {
+            ++bad;
+            continue;
+        }
+        for (size_t l = 0; l < sizeof lens / sizeof lens[0]; ++l) {
+            ghash(k, msg, lens[l], &expected);
+            ghash_parallel(pool, k, msg, lens[l], &res);
+            if (!equal(res, expected)) {
+                fprintf(stderr, "ghash_parallel: mismatch for length %lu "
+                        "with %u threads\n", lens[l], nthreads[t]);
+                ++bad;
+            }
+        }
+        threadpool_destroy(pool);
+    }
+    ot_free(msg);
+    return bad;
+}
+
+/*
+ * Runs the checks in a child process with CPU_ENV set to 'features', or
+ * unset if 'features' is NULL.
+ */
+static int
+run(const char *features)
+{
+    pid_t pid;
+    int status;
+
+    if ((pid = fork()) == -1)
+        return 1;
+    if (pid == 0) {
+        int bad;
+
+        if (features)
+            (void) setenv(CPU_ENV, features, 1);
+        else
+            (void) unsetenv(CPU_ENV);
+        bad = check_streaming();
+        bad += check_parallel();
+        printf("%s=%s (features %#x): %s\n", CPU_ENV,
+               features ? features : "<unset>", cpu_features(),
+               bad ? "FAILED" : "ok");
+        (void) fflush(stdout);
+        _exit(bad ? EXIT_FAILURE : EXIT_SUCCESS);
+    }
+    if (waitpid(pid, &status, 0) == -1)
+        return 1;
+    return !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS;
+}
+
+int
+main(void)
+{
+    int bad = 0;
+
+    srand(1);
+    bad |= run(NULL);
+    bad |= run("0");
+
+    return bad ? EXIT_FAILURE : EXIT_SUCCESS;
+}
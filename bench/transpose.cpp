@@ -0,0 +1,189 @@
+/*
+ * Micro-benchmark for bit_transpose() on the matrix shapes used by IKNP OT
+ * extension: the secparam x m column matrix is transposed into m rows of
+ * secparam bits, for secparam in {80, 128}.
+ *
+ * Before timing anything, bit_transpose() and bit_transpose_strided() are
+ * checked against a bit-by-bit transpose on shapes that hit every kernel and
+ * its tail, with row strides longer than the rows; the padding between output
+ * rows must be left untouched.  As in ghash.cpp, the checks run in child
+ * processes with CPU_ENV unset and set to 0.
+ */
+#include "cpu.h"
+#include "transpose.h"
+#include "utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define NITERS 5
+#define PAD 0xa5                /* fill byte of the output padding */
+
+static int
+get_bit(const unsigned char *m, size_t stride, size_t r, size_t c)
+{
+    return (m[r * stride + c / 8] >> (7 - c % 8)) & 1;
+}
+
+/*
+ * Transposes a random 'nrows' x 'ncols' matrix with the given extra bytes of
+ * padding after each input and output row, and compares the result with the
+ * bit-by-bit transpose.  Returns the number of mismatches.
+ */
+static int
+check_shape(size_t nrows, size_t ncols, size_t inpad, size_t outpad)
+{
+    const size_t instride = ncols / 8 + inpad, outstride = nrows / 8 + outpad;
+    unsigned char *in, *out;
+    int bad = 0;
+
+    in = (unsigned char *) ot_malloc(nrows * instride);
+    out = (unsigned char *) ot_malloc(ncols * outstride);
+    if (in == NULL || out == NULL) {
+        bad = 1;
+        goto cleanup;
+    }
+    for (size_t i = 0; i < nrows * instride; ++i)
+        in[i] = (unsigned char) rand();
+    (void) memset(out, PAD, ncols * outstride);
+
+    if (inpad == 0 && outpad == 0)
+        bit_transpose(out, in, nrows, ncols);
+    else
+        bit_transpose_strided(out, outstride, in, instride, nrows, ncols);
+
+    for (size_t c = 0; c < ncols && !bad; ++c) {
+        for (size_t r = 0; r < nrows; ++r) {
+            if (get_bit(out, outstride, c, r) != get_bit(in, instride, r, c)) {
+                fprintf(stderr, "%lu x %lu (pads %lu, %lu): bit (%lu, %lu) "
+                        "differs\n", nrows, ncols, inpad, outpad, c, r);
+                bad = 1;
+                break;
+            }
+        }
+        for (size_t i = nrows / 8; i < outstride; ++i) {
+            if (out[c * outstride + i] != PAD) {
+                fprintf(stderr, "%lu x %lu (pads %lu, %lu): padding of row "
+                        "%lu overwritten\n", nrows, ncols, inpad, outpad, c);
+                bad = 1;
+                break;
+            }
+        }
+    }
+
+ cleanup:
+    if (in)
+        ot_free(in);
+    if (out)
+        ot_free(out);
+    return bad;
+}
+
+static int
+check(void)
+{
+    /* 32- and 16-row kernels with and without an 8-row tail */
+    static const size_t rows[] = { 8, 16, 24, 32, 40, 56, 72, 136 };
+    /* 128-column kernels, their tail and more than one cache block */
+    static const size_t cols[] = { 8, 120, 128, 136, 1160, 2056 };
+    static const size_t pads[][2] = { { 0, 0 }, { 3, 0 }, { 0, 5 }, { 17, 9 } };
+    int bad = 0;
+
+    for (size_t i = 0; i < sizeof rows / sizeof rows[0]; ++i) {
+        for (size_t j = 0; j < sizeof cols / sizeof cols[0]; ++j) {
+            for (size_t k = 0; k < sizeof pads / sizeof pads[0]; ++k) {
+                bad += check_shape(rows[i], cols[j], pads[k][0], pads[k][1]);
+            }
+        }
+    }
+    return bad;
+}
+
+/*
+ * Runs the checks in a child process with CPU_ENV set to 'features', or
+ * unset if 'features' is NULL.
+ */
+static int
+run(const char *features)
+{
+    pid_t pid;
+    int status;
+
+    if ((pid = fork()) == -1)
+        return 1;
+    if (pid == 0) {
+        int bad;
+
+        if (features)
+            (void) setenv(CPU_ENV, features, 1);
+        else
+            (void) unsetenv(CPU_ENV);
+        bad = check();
+        printf("%s=%s (features %#x): %s\n", CPU_ENV,
+               features ? features : "<unset>", cpu_features(),
+               bad ? "FAILED" : "ok");
+        (void) fflush(stdout);
+        _exit(bad ? EXIT_FAILURE : EXIT_SUCCESS);
+    }
+    if (waitpid(pid, &status, 0) == -1)
+        return 1;
+    return !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS;
+}
+
+static void
+bench(size_t m, size_t secparam)
+{
+    unsigned char *in, *out;
+    size_t nbytes = m * secparam / 8;
+    double start, end, best = -1.0;
+
+    in = (unsigned char *) ot_malloc(nbytes);
+    out = (unsigned char *) ot_malloc(nbytes);
+    if (in == NULL || out == NULL) {
+        fprintf(stderr, "unable to allocate %lu bytes\n", nbytes);
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < nbytes; ++i)
+        in[i] = (unsigned char) rand();
+
+    for (int i = 0; i < NITERS; ++i) {
+        start = current_time();
+        bit_transpose(out, in, secparam, m);
+        end = current_time();
+        if (best < 0 || end - start < best)
+            best = end - start;
+    }
+    printf("%10lu x %3lu: %f s, %6.2f GB/s\n", m, secparam, best,
+           nbytes / best / 1e9);
+
+    ot_free(in);
+    ot_free(out);
+}
+
+int
+main(int argc, char *argv[])
+{
+    size_t m = 1 << 24;
+    int bad = 0;
+
+    if (argc > 1)
+        m = strtoul(argv[1], NULL, 10);
+    if (m % 8 != 0) {
+        fprintf(stderr, "m must be divisible by 8\n");
+        return EXIT_FAILURE;
+    }
+
+    srand(1);
+    bad |= run(NULL);
+    bad |= run("0");
+    if (bad)
+        return EXIT_FAILURE;
+
+    bench(m, 80);
+    bench(m, 128);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,20 @@
+import _otlib as _ot
+
+# must match enum group_type in src/group.h
+GROUP_FF = 0
+GROUP_EC = 1
+
+class OTSender(object):
+    def __init__(self, state, group=GROUP_EC):
+        self._state = state
+        self._group = group
+    def send(self, msgs, msglength):
+        _ot.ot_co_send(self._state, msgs, msglength, self._group)
+
+class OTReceiver(object):
+    def __init__(self, state, group=GROUP_EC):
+        self._state = state
+        self._group = group
+    def receive(self, choices, msglength, N=2):
+        return _ot.ot_co_receive(self._state, choices, N, msglength,
+                                 self._group)
@@ -1,80 +1,133 @@
 from __future__ import print_function
 
-import random, time
-import numpy as np
+import time
 
 import _otlib as _ot
 
+SEEDLEN = 16
+
 def binstr2bytes(s):
     return ''.join([chr(int(s[8*i:8*i+8], 2)) for i in xrange(len(s) / 8)])
 
+def random_bits(state, n):
+    """Returns n random bits from the state's generator, as a list."""
+    b = _ot.random_bytes(state, (n + 7) / 8)
+    return [(ord(b[i / 8]) >> (7 - i % 8)) & 1 for i in xrange(n)]
+
+def random_seeds(state, n):
+    """Returns n pairs of random base OT seeds from the state's generator."""
+    b = _ot.random_bytes(state, 2 * n * SEEDLEN)
+    return [(b[2*i*SEEDLEN:(2*i+1)*SEEDLEN],
+             b[(2*i+1)*SEEDLEN:(2*i+2)*SEEDLEN]) for i in xrange(n)]
+
 class OTExtSender(object):
     def __init__(self, state):
         self._state = state
 
-    def send(self, msgs, maxlength, otmodule, secparam=80):
-        m = len(msgs)
-        assert m % 8 == 0, "length of 'msgs' must be divisible by 8"
-
+    def _base_ot(self, m, otmodule, secparam):
         print('---OT---')
 
         start = time.time()
         ot = otmodule.OTReceiver(self._state)
-        s = [random.randint(0, 1) for _ in xrange(secparam)]
+        s = random_bits(self._state, secparam)
         end = time.time()
         print('Initialize: %f' % (end - start))
 
+        # base OTs only transfer seeds; Q is expanded from them
         start = time.time()
-        Q = ot.receive(s, m / 8)
+        seeds = ot.receive(s, SEEDLEN)
         end = time.time()
         print('OT receive: %f' % (end - start))
 
         print('---OT Extension---')
 
-        start = time.time()
         s = binstr2bytes(''.join([str(e) for e in s]))
-        end = time.time()
-        print('binstr2bytes: %f' % (end - start))
-        
+        Q = _ot.otext_expand_send(self._state, seeds, s, secparam, m)
+
+        return s, Q
+
+    def send(self, msgs, maxlength, otmodule, secparam=80):
+        m = len(msgs)
+        assert m % 8 == 0, "length of 'msgs' must be divisible by 8"
+
+        s, Q = self._base_ot(m, otmodule, secparam)
         _ot.otext_iknp_send(self._state, msgs, Q, s, maxlength, secparam)
 
+    def send_random(self, m, maxlength, otmodule, secparam=80):
+        """Returns m pairs of random messages; nothing is sent after the base
+        OTs.  Use derandomize() to later transfer chosen messages."""
+        assert m % 8 == 0, "'m' must be divisible by 8"
+
+        s, Q = self._base_ot(m, otmodule, secparam)
+        return _ot.otext_iknp_send_random(self._state, Q, s, m, maxlength,
+                                          secparam)
+
+    def send_correlated(self, m, delta, otmodule, secparam=80):
+        """Returns the m 16-byte messages m_0; the receiver obtains either m_0
+        or m_0 xor delta."""
+        assert m % 8 == 0, "'m' must be divisible by 8"
+
+        s, Q = self._base_ot(m, otmodule, secparam)
+        return _ot.otext_iknp_send_correlated(self._state, Q, s, m, delta,
+                                              secparam)
+
+    def derandomize(self, msgs, rand, maxlength):
+        _ot.otext_iknp_derandomize_send(self._state, msgs, rand, maxlength)
+
 class OTExtReceiver(object):
     def __init__(self, state):
         self._state = state
 
-    def receive(self, choices, maxlength, otmodule, secparam=80):
+    def _base_ot(self, choices, otmodule, secparam):
         nchoices = len(choices)
-        assert nchoices % 8 == 0, "length of 'choices' must be divisible by 8"
 
         print('---OT---')
 
         start = time.time()
         ot = otmodule.OTSender(self._state)
+        seeds = random_seeds(self._state, secparam)
         end = time.time()
         print('Initialize OTSender: %f' % (end - start))
 
         start = time.time()
-        r = binstr2bytes(''.join([str(c) for c in choices]))
+        ot.send(seeds, SEEDLEN)
         end = time.time()
-        print('binstr2bytes: %f' % (end - start))
+        print('OT send: %f' % (end - start))
 
-        start = time.time()
-        T = [np.random.bytes(nchoices / 8) for _ in xrange(secparam)]
-        end = time.time()
-        print('build T: %f' % (end - start))
+        print('---OT Extension---')
 
-        start = time.time()
-        inputs = _ot.otext_iknp_matrix_xor(self._state, T, r, nchoices, secparam)
-        end = time.time()
-        print('xor: %f' % (end - start))
+        r = binstr2bytes(''.join([str(c) for c in choices]))
+        T = _ot.otext_expand_receive(self._state, seeds, r, secparam, nchoices)
 
-        start = time.time()
-        ot.send(inputs, nchoices / 8)
-        end = time.time()
-        print('OT send: %f' % (end - start))
+        return T
 
-        print('---OT Extension---')
+    def receive(self, choices, maxlength, otmodule, secparam=80):
+        nchoices = len(choices)
+        assert nchoices % 8 == 0, "length of 'choices' must be divisible by 8"
 
+        T = self._base_ot(choices, otmodule, secparam)
         r = _ot.otext_iknp_receive(self._state, choices, T, maxlength, secparam)
 
         return r
+
+    def receive_random(self, choices, maxlength, otmodule, secparam=80):
+        """Returns the random message selected by each choice bit; nothing is
+        received after the base OTs."""
+        nchoices = len(choices)
+        assert nchoices % 8 == 0, "length of 'choices' must be divisible by 8"
+
+        T = self._base_ot(choices, otmodule, secparam)
+        return _ot.otext_iknp_receive_random(self._state, T, nchoices,
+                                             maxlength, secparam)
+
+    def receive_correlated(self, choices, otmodule, secparam=80):
+        nchoices = len(choices)
+        assert nchoices % 8 == 0, "length of 'choices' must be divisible by 8"
+
+        T = self._base_ot(choices, otmodule, secparam)
+        return _ot.otext_iknp_receive_correlated(self._state, choices, T,
+                                                 secparam)
+
+    def derandomize(self, choices, rchoices, rand, maxlength):
+        return _ot.otext_iknp_derandomize_receive(self._state, choices,
+                                                  rchoices, rand, maxlength)
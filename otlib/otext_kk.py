@@ -0,0 +1,63 @@
+from __future__ import print_function
+
+import time
+
+import _otlib as _ot
+from otext_iknp import binstr2bytes, random_bits, random_seeds, SEEDLEN
+
+CODEBITS = 256
+
+class OTExtSender(object):
+    def __init__(self, state):
+        self._state = state
+
+    def send(self, msgs, maxlength, otmodule):
+        m = len(msgs)
+        assert m % 8 == 0, "length of 'msgs' must be divisible by 8"
+
+        print('---OT---')
+
+        start = time.time()
+        ot = otmodule.OTReceiver(self._state)
+        s = random_bits(self._state, CODEBITS)
+        end = time.time()
+        print('Initialize: %f' % (end - start))
+
+        start = time.time()
+        seeds = ot.receive(s, SEEDLEN)
+        end = time.time()
+        print('OT receive: %f' % (end - start))
+
+        print('---OT Extension---')
+
+        s = binstr2bytes(''.join([str(e) for e in s]))
+        Q = _ot.otext_expand_send(self._state, seeds, s, CODEBITS, m)
+        _ot.otext_kk_send(self._state, msgs, Q, s, maxlength)
+
+class OTExtReceiver(object):
+    def __init__(self, state):
+        self._state = state
+
+    def receive(self, choices, N, maxlength, otmodule):
+        nchoices = len(choices)
+        assert nchoices % 8 == 0, "length of 'choices' must be divisible by 8"
+
+        print('---OT---')
+
+        start = time.time()
+        ot = otmodule.OTSender(self._state)
+        seeds = random_seeds(self._state, CODEBITS)
+        end = time.time()
+        print('Initialize OTSender: %f' % (end - start))
+
+        start = time.time()
+        ot.send(seeds, SEEDLEN)
+        end = time.time()
+        print('OT send: %f' % (end - start))
+
+        print('---OT Extension---')
+
+        C = _ot.otext_kk_codewords(choices, N)
+        T = _ot.otext_expand_receive(self._state, seeds, C, CODEBITS, nchoices)
+
+        return _ot.otext_kk_receive(self._state, choices, T, N, maxlength)
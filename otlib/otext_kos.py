@@ -0,0 +1,25 @@
+from __future__ import print_function
+
+import _otlib as _ot
+import otext_iknp as iknp
+
+# extra random OTs hiding the receiver's choices from the correlation check
+PAD = _ot.OTEXT_KOS_PAD
+
+class OTExtSender(iknp.OTExtSender):
+    def send(self, msgs, maxlength, otmodule, secparam=128):
+        m = len(msgs)
+        assert m % 8 == 0, "length of 'msgs' must be divisible by 8"
+
+        s, Q = self._base_ot(m + PAD, otmodule, secparam)
+        _ot.otext_kos_send(self._state, msgs, Q, s, maxlength, secparam)
+
+class OTExtReceiver(iknp.OTExtReceiver):
+    def receive(self, choices, maxlength, otmodule, secparam=128):
+        nchoices = len(choices)
+        assert nchoices % 8 == 0, "length of 'choices' must be divisible by 8"
+
+        choices = list(choices) + iknp.random_bits(self._state, PAD)
+        T = self._base_ot(choices, otmodule, secparam)
+        return _ot.otext_kos_receive(self._state, choices, T, maxlength,
+                                     secparam)
@@ -1,36 +1,55 @@
-from __future__ import division, print_function
+from __future__ import print_function
 
-import math, random, time
+import time
 
 import _otlib as _ot
+from otext_iknp import SEEDLEN, binstr2bytes, random_bits, random_seeds
 
 class OTExtSender(object):
     def __init__(self, state):
         self._state = state
 
-    def send(self, bits, otmodule, secparam=80):
-        m = len(bits)
-        assert m > secparam, "number of messages must be greater than security parameter"
-        num = int(math.ceil(8 / 3 * secparam))
-        print('ceil(8/3 secparam) = %d' % num)
-        rbits = [random.randint(0, 1) for _ in xrange(num)]
+    def send(self, msgs, maxlength, otmodule, secparam=80):
+        m = len(msgs)
+        assert m % 8 == 0, "length of 'msgs' must be divisible by 8"
+        num = _ot.otext_nnob_ncols(secparam)
+
+        print('---OT---')
+
+        start = time.time()
         ot = otmodule.OTReceiver(self._state)
-        ells = ot.receive(rbits, int(secparam / 8))
-        _ot.otext_nnob_send(self._state, bits, ells, secparam)
+        s = random_bits(self._state, num)
+        seeds = ot.receive(s, SEEDLEN)
+        end = time.time()
+        print('OT receive (%d base OTs): %f' % (num, end - start))
+
+        print('---OT Extension---')
+
+        s = binstr2bytes(''.join([str(e) for e in s]))
+        Q = _ot.otext_expand_send(self._state, seeds, s, num, m)
+        _ot.otext_nnob_send(self._state, msgs, Q, s, maxlength, secparam)
 
 class OTExtReceiver(object):
     def __init__(self, state):
         self._state = state
 
-    def receive(self, choices, otmodule, secparam=80):
-        m = len(choices)
-        assert m > secparam, "number of choices must be greater than security parameter"
-        def randseed():
-            return random.randint(0, 2 ** secparam - 1)
-        num = int(math.ceil(8 / 3 * secparam))
-        print('ceil(8/3 secparam) = %d' % num)
-        seeds = [(randseed(), randseed()) for _ in xrange(num)]
+    def receive(self, choices, maxlength, otmodule, secparam=80):
+        nchoices = len(choices)
+        assert nchoices % 8 == 0, "length of 'choices' must be divisible by 8"
+        num = _ot.otext_nnob_ncols(secparam)
+
+        print('---OT---')
+
+        start = time.time()
         ot = otmodule.OTSender(self._state)
-        ot.send(seeds, int(secparam / 8))
-        _ot.otext_nnob_receive(self._state, choices, seeds, secparam)
-            
+        seeds = random_seeds(self._state, num)
+        ot.send(seeds, SEEDLEN)
+        end = time.time()
+        print('OT send (%d base OTs): %f' % (num, end - start))
+
+        print('---OT Extension---')
+
+        r = binstr2bytes(''.join([str(c) for c in choices]))
+        T = _ot.otext_expand_receive(self._state, seeds, r, num, nchoices)
+        return _ot.otext_nnob_receive(self._state, choices, T, maxlength,
+                                      secparam)
@@ -15,7 +15,7 @@ import otlib.otext_nnob as nnob
 import otlib._otlib as _ot
 
 def sender(args):
-    state = _ot.init('127.0.0.1', repr(5000), 80, True)
+    state = _ot.init('127.0.0.1', repr(5000), 80, True, args.nthreads)
     msgs = (('a' * MAXLENGTH, 'b' * MAXLENGTH),) * args.niters
     start = time.time()
     if args.test_iknp:
@@ -23,7 +23,7 @@ def sender(args):
         ot.send(msgs, MAXLENGTH, np)
     if args.test_nnob:
         ot = nnob.OTExtSender(state)
-        ot.send(msgs, pvw)
+        ot.send(msgs, MAXLENGTH, pvw)
     if args.test_np:
         ot = np.OTSender(state)
         ot.send(msgs, MAXLENGTH)
@@ -31,11 +31,12 @@ def sender(args):
         ot = pvw.OTSender(state)
         ot.send(msgs, MAXLENGTH)
     end = time.time()
-    print('Sender time (%d iterations): %f' % (args.niters, end - start))
+    print('Sender time (%d iterations): %f (%.0f OTs/s)'
+          % (args.niters, end - start, args.niters / (end - start)))
         
 
 def receiver(args):
-    state = _ot.init('127.0.0.1', repr(5000), 80, False)
+    state = _ot.init('127.0.0.1', repr(5000), 80, False, args.nthreads)
     choices = [random.randint(0, 1) for _ in xrange(args.niters)]
     start = time.time()
     if args.test_iknp:
@@ -43,7 +44,7 @@ def receiver(args):
         r = ot.receive(choices, MAXLENGTH, np)
     if args.test_nnob:
         ot = nnob.OTExtReceiver(state)
-        r = ot.receive(choices, pvw)
+        r = ot.receive(choices, MAXLENGTH, pvw)
     if args.test_np:
         ot = np.OTReceiver(state)
         r = ot.receive(choices, MAXLENGTH)
@@ -52,7 +53,8 @@ def receiver(args):
         r = ot.receive(choices, MAXLENGTH)
     end = time.time()
     print(r[:4])
-    print('Receiver time (%d iterations): %f' % (args.niters, end - start))
+    print('Receiver time (%d iterations): %f (%.0f OTs/s)'
+          % (args.niters, end - start, args.niters / (end - start)))
 
 
 def main():
@@ -80,6 +82,9 @@ def main():
     parser_sender.add_argument(
         '--niters', action='store', type=int, default=80,
         help='number of iterations')
+    parser_sender.add_argument(
+        '--nthreads', action='store', type=int, default=1,
+        help='number of worker threads')
     parser_sender.set_defaults(func=sender)
 
     parser_receiver = subparsers.add_parser(
@@ -101,6 +106,9 @@ def main():
     parser_receiver.add_argument(
         '--niters', action='store', type=int, default=80,
         help='number of iterations')
+    parser_receiver.add_argument(
+        '--nthreads', action='store', type=int, default=1,
+        help='number of worker threads')
     parser_receiver.set_defaults(func=receiver)
 
     args = parser.parse_args()
@@ -7,23 +7,36 @@ __version__ = '0.0'
 __author__ = 'Alex J. Malozemoff'
 
 extra_sources = [
+    'ot_co.cpp',
     'ot_np.cpp',
-    #'ot_pvw.cpp',
+    'ot_pvw.cpp',
+    'otext.cpp',
     'otext_iknp.cpp',
-    #'otext_nnob.cpp',
+    'otext_kk.cpp',
+    'otext_nnob.cpp',
     # python wrappers
     'python/py_state.cpp',
     'python/py_ot.cpp',
+    'python/py_ot_co.cpp',
     'python/py_ot_np.cpp',
+    'python/py_ot_pvw.cpp',
+    'python/py_otext.cpp',
     'python/py_otext_iknp.cpp',
+    'python/py_otext_kk.cpp',
+    'python/py_otext_nnob.cpp',
     # utils
     'aes.cpp',
+    'cpu.cpp',
     'ghash.cpp',
     'crypto.cpp',
     'gmputils.cpp',
+    'group.cpp',
     'log.cpp',
     'net.cpp',
+    'pvw_crs.cpp',
     'state.cpp',
+    'threadpool.cpp',
+    'transpose.cpp',
     'utils.cpp',
     # cmp
     'cmp/cmp.c',
@@ -32,7 +45,7 @@ extra_sources = map(lambda f: 'src/' + f, extra_sources)
 
 otlib = Extension(
     'otlib._otlib',
-    libraries = ['gmp', 'ssl', 'crypto'],
+    libraries = ['gmp', 'ssl', 'crypto', 'pthread'],
     extra_compile_args = ['-g', '-Wall', '-maes', '-msse4', '-mpclmul'],
     extra_objects = ['src/gfmul.a'],
     sources = [
@@ -18,10 +18,15 @@
 
 #include "aes.h"
 
+#include "cpu.h"
+
 #include <stdio.h>
 #include <string.h>
+#include <immintrin.h>
 #include <wmmintrin.h>
 
+#define AES_BATCH 32            /* blocks encrypted per AES_ecb_encrypt_blks */
+
 #define EXPAND_ASSIST(v1,v2,v3,v4,shuff_const,aes_const)                \
     v2 = _mm_aeskeygenassist_si128(v4,aes_const);                       \
     v3 = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(v3),          \
@@ -179,22 +184,163 @@ AES_encrypt_message(const unsigned char *in, size_t inlength,
 
     (void) memset(integer, '\0', sizeof integer);
 
-    for (unsigned int i = 0; i < outlength / 16; ++i) {
+    for (unsigned int i = 0; i < (outlength + 15) / 16; ++i) {
         __m128i tmp;
 
         (void) memcpy(integer, (char *) &i, sizeof i);
-        tmp = _mm_load_si128((__m128i *) integer);
+        tmp = _mm_loadu_si128((__m128i *) integer);
         tmp = _mm_xor_si128(tmp, in128);
         for (int j = 1; j < rnds; ++j) {
             tmp = _mm_aesenc_si128(tmp, sched[j]);
         }
         tmp = _mm_aesenclast_si128(tmp, sched[rnds]);
-        _mm_store_si128((__m128i *) (out + i * 16), tmp);
+        if (outlength - i * 16 >= 16) {
+            _mm_storeu_si128((__m128i *) (out + i * 16), tmp);
+        } else {
+            unsigned char last[16];
+            _mm_storeu_si128((__m128i *) last, tmp);
+            (void) memcpy(out + i * 16, last, outlength - i * 16);
+        }
     }
 
     return 0;
 }
 
+static inline void
+store_partial(unsigned char *out, block blk, size_t len)
+{
+    if (len >= 16) {
+        _mm_storeu_si128((__m128i *) out, blk);
+    } else {
+        unsigned char last[16];
+        _mm_storeu_si128((__m128i *) last, blk);
+        (void) memcpy(out, last, len);
+    }
+}
+
+/*
+ * Batched version of AES_encrypt_message: hashes the 'nmsgs' blocks in 'in',
+ * writing 'outlength' bytes for each to consecutive positions in 'out'.  All
+ * (message, counter) pairs are flattened and encrypted AES_BATCH at a time so
+ * the AES unit is kept busy with independent blocks.
+ */
+void
+AES_encrypt_messages(const block *in, unsigned int nmsgs,
+                     unsigned char *out, size_t outlength, const AES_KEY *key)
+{
+    const unsigned int nblks = (outlength + 15) / 16;
+    const unsigned long total = (unsigned long) nmsgs * nblks;
+    block blks[AES_BATCH];
+
+    for (unsigned long g = 0; g < total; g += AES_BATCH) {
+        unsigned int n = total - g < AES_BATCH ? total - g : AES_BATCH;
+
+        unsigned long idx = g / nblks;
+        unsigned int ctr = g % nblks;
+
+        for (unsigned int k = 0; k < n; ++k) {
+            blks[k] = _mm_xor_si128(in[idx], _mm_cvtsi32_si128(ctr));
+            if (++ctr == nblks) {
+                ctr = 0;
+                ++idx;
+            }
+        }
+        AES_ecb_encrypt_blks(blks, n, key);
+        idx = g / nblks;
+        ctr = g % nblks;
+        for (unsigned int k = 0; k < n; ++k) {
+            store_partial(out + idx * outlength + ctr * 16, blks[k],
+                          outlength - ctr * 16);
+            if (++ctr == nblks) {
+                ctr = 0;
+                ++idx;
+            }
+        }
+    }
+}
+
+/*
+ * Expands the 16-byte 'seed' into 'outlength' pseudorandom bytes by running
+ * AES in counter mode under the key 'seed'.
+ */
+void
+AES_ctr_expand(const unsigned char *seed, unsigned char *out,
+               size_t outlength)
+{
+    AES_KEY key;
+    block zero = _mm_setzero_si128();
+
+    AES_set_encrypt_key(seed, 128, &key);
+    AES_encrypt_messages(&zero, 1, out, outlength, &key);
+}
+
+static const unsigned char fixed_key[16] = {
+    0x61, 0x7e, 0x8d, 0xa2, 0xa0, 0x51, 0x1e, 0x96,
+    0x5e, 0x41, 0xc2, 0x9b, 0x15, 0x3f, 0xc7, 0x7a
+};
+
+/*
+ * Expands the key schedule of the fixed public permutation used by
+ * AES_crhash_messages.
+ */
+void
+AES_set_fixed_key(AES_KEY *key)
+{
+    AES_set_encrypt_key(fixed_key, 128, key);
+}
+
+/*
+ * Fixed-key correlation-robust hash H(x, j) = pi(x ^ j) ^ x ^ j, where pi is
+ * AES under the fixed key.  Message 'idx' of 'in' uses tweak
+ * j = 'tweak' + idx / 'stride', so that groups of 'stride' consecutive
+ * messages share a tweak, and is expanded to 'outlength' bytes by placing the
+ * block counter in the upper half of the tweak.
+ */
+void
+AES_crhash_messages(const block *in, unsigned int nmsgs, unsigned int stride,
+                    unsigned long tweak, unsigned char *out, size_t outlength,
+                    const AES_KEY *key)
+{
+    const unsigned int nblks = (outlength + 15) / 16;
+    const unsigned long total = (unsigned long) nmsgs * nblks;
+    block blks[AES_BATCH], xs[AES_BATCH];
+
+    for (unsigned long g = 0; g < total; g += AES_BATCH) {
+        unsigned int n = total - g < AES_BATCH ? total - g : AES_BATCH;
+
+        /* divide once per batch; within it, (idx, ctr) and idx = grp * stride
+           + rem are stepped like odometers */
+        unsigned long idx = g / nblks, grp = idx / stride;
+        unsigned int ctr = g % nblks, rem = idx % stride;
+
+        for (unsigned int k = 0; k < n; ++k) {
+            xs[k] = _mm_xor_si128(in[idx],
+                                  _mm_set_epi64x((long long) ctr,
+                                                 (long long) (tweak + grp)));
+            blks[k] = xs[k];
+            if (++ctr == nblks) {
+                ctr = 0;
+                ++idx;
+                if (++rem == stride) {
+                    rem = 0;
+                    ++grp;
+                }
+            }
+        }
+        AES_ecb_encrypt_blks(blks, n, key);
+        idx = g / nblks;
+        ctr = g % nblks;
+        for (unsigned int k = 0; k < n; ++k) {
+            store_partial(out + idx * outlength + ctr * 16,
+                          _mm_xor_si128(blks[k], xs[k]), outlength - ctr * 16);
+            if (++ctr == nblks) {
+                ctr = 0;
+                ++idx;
+            }
+        }
+    }
+}
+
 void
 AES_encrypt(const unsigned char *in, unsigned char *out, const AES_KEY *key)
 {
@@ -221,11 +367,79 @@ AES_decrypt(const unsigned char *in, unsigned char *out, const AES_KEY *key)
     _mm_store_si128((__m128i *) out, tmp);
 }
 
+/*
+ * VAES kernel: each instruction handles four blocks, and sixteen blocks are in
+ * flight to cover the latency.  Returns the number of blocks encrypted, a
+ * multiple of four.  Inlined with a constant 'rnds' so that the round loop is
+ * unrolled and the round keys stay in registers.
+ */
+__attribute__((target("avx512f,vaes")))
+static inline unsigned int
+ecb_encrypt_blks_vaes_rounds(block *blks, unsigned int nblks,
+                             const AES_KEY *key, const int rnds)
+{
+    __m512i sched[15], b0, b1, b2, b3;
+    unsigned int i = 0;
+
+    /* the maskz forms avoid the undefined source of the plain intrinsic,
+       which -Wall reports as uninitialized */
+    for (int j = 0; j <= rnds; ++j)
+        sched[j] = _mm512_maskz_broadcast_i32x4(0xffff, key->rd_key[j]);
+    for (; i + 16 <= nblks; i += 16) {
+        b0 = _mm512_xor_si512(_mm512_loadu_si512(&blks[i]), sched[0]);
+        b1 = _mm512_xor_si512(_mm512_loadu_si512(&blks[i + 4]), sched[0]);
+        b2 = _mm512_xor_si512(_mm512_loadu_si512(&blks[i + 8]), sched[0]);
+        b3 = _mm512_xor_si512(_mm512_loadu_si512(&blks[i + 12]), sched[0]);
+        for (int j = 1; j < rnds; ++j) {
+            b0 = _mm512_aesenc_epi128(b0, sched[j]);
+            b1 = _mm512_aesenc_epi128(b1, sched[j]);
+            b2 = _mm512_aesenc_epi128(b2, sched[j]);
+            b3 = _mm512_aesenc_epi128(b3, sched[j]);
+        }
+        _mm512_storeu_si512(&blks[i], _mm512_aesenclast_epi128(b0, sched[rnds]));
+        _mm512_storeu_si512(&blks[i + 4],
+                            _mm512_aesenclast_epi128(b1, sched[rnds]));
+        _mm512_storeu_si512(&blks[i + 8],
+                            _mm512_aesenclast_epi128(b2, sched[rnds]));
+        _mm512_storeu_si512(&blks[i + 12],
+                            _mm512_aesenclast_epi128(b3, sched[rnds]));
+    }
+    for (; i + 4 <= nblks; i += 4) {
+        b0 = _mm512_xor_si512(_mm512_loadu_si512(&blks[i]), sched[0]);
+        for (int j = 1; j < rnds; ++j)
+            b0 = _mm512_aesenc_epi128(b0, sched[j]);
+        _mm512_storeu_si512(&blks[i], _mm512_aesenclast_epi128(b0, sched[rnds]));
+    }
+    return i;
+}
+
+__attribute__((target("avx512f,vaes")))
+static unsigned int
+ecb_encrypt_blks_vaes(block *blks, unsigned int nblks, const AES_KEY *key)
+{
+    switch (ROUNDS(key)) {
+    case 10:
+        return ecb_encrypt_blks_vaes_rounds(blks, nblks, key, 10);
+    case 12:
+        return ecb_encrypt_blks_vaes_rounds(blks, nblks, key, 12);
+    default:
+        return ecb_encrypt_blks_vaes_rounds(blks, nblks, key, 14);
+    }
+}
+
 void
-AES_ecb_encrypt_blks(block *blks, unsigned nblks, AES_KEY *key)
+AES_ecb_encrypt_blks(block *blks, unsigned nblks, const AES_KEY *key)
 {
     unsigned int i, j, rnds = ROUNDS(key);
     const __m128i *sched = ((__m128i *) (key->rd_key));
+
+    if (cpu_has(CPU_VAES)) {
+        i = ecb_encrypt_blks_vaes(blks, nblks, key);
+        blks += i;
+        nblks -= i;
+    }
+    for (; nblks >= 8; blks += 8, nblks -= 8)
+        AES_ecb_encrypt_blks_8(blks, key);
     for (i = 0; i < nblks; ++i)
         blks[i] = _mm_xor_si128(blks[i], sched[0]);
     for (j = 1; j < rnds; ++j)
@@ -236,7 +450,7 @@ AES_ecb_encrypt_blks(block *blks, unsigned nblks, AES_KEY *key)
 }
 
 void
-AES_ecb_encrypt_blks_4(block *blks, AES_KEY *key)
+AES_ecb_encrypt_blks_4(block *blks, const AES_KEY *key)
 {
     unsigned int j, rnds = ROUNDS(key);
     const __m128i *sched = ((__m128i *) (key->rd_key));
@@ -258,7 +472,43 @@ AES_ecb_encrypt_blks_4(block *blks, AES_KEY *key)
 }
 
 void
-AES_ecb_decrypt_blks(block *blks, unsigned nblks, AES_KEY *key)
+AES_ecb_encrypt_blks_8(block *blks, const AES_KEY *key)
+{
+    unsigned int j, rnds = ROUNDS(key);
+    const __m128i *sched = ((__m128i *) (key->rd_key));
+    __m128i b0, b1, b2, b3, b4, b5, b6, b7;
+
+    b0 = _mm_xor_si128(blks[0], sched[0]);
+    b1 = _mm_xor_si128(blks[1], sched[0]);
+    b2 = _mm_xor_si128(blks[2], sched[0]);
+    b3 = _mm_xor_si128(blks[3], sched[0]);
+    b4 = _mm_xor_si128(blks[4], sched[0]);
+    b5 = _mm_xor_si128(blks[5], sched[0]);
+    b6 = _mm_xor_si128(blks[6], sched[0]);
+    b7 = _mm_xor_si128(blks[7], sched[0]);
+
+    for (j = 1; j < rnds; ++j) {
+        b0 = _mm_aesenc_si128(b0, sched[j]);
+        b1 = _mm_aesenc_si128(b1, sched[j]);
+        b2 = _mm_aesenc_si128(b2, sched[j]);
+        b3 = _mm_aesenc_si128(b3, sched[j]);
+        b4 = _mm_aesenc_si128(b4, sched[j]);
+        b5 = _mm_aesenc_si128(b5, sched[j]);
+        b6 = _mm_aesenc_si128(b6, sched[j]);
+        b7 = _mm_aesenc_si128(b7, sched[j]);
+    }
+    blks[0] = _mm_aesenclast_si128(b0, sched[j]);
+    blks[1] = _mm_aesenclast_si128(b1, sched[j]);
+    blks[2] = _mm_aesenclast_si128(b2, sched[j]);
+    blks[3] = _mm_aesenclast_si128(b3, sched[j]);
+    blks[4] = _mm_aesenclast_si128(b4, sched[j]);
+    blks[5] = _mm_aesenclast_si128(b5, sched[j]);
+    blks[6] = _mm_aesenclast_si128(b6, sched[j]);
+    blks[7] = _mm_aesenclast_si128(b7, sched[j]);
+}
+
+void
+AES_ecb_decrypt_blks(block *blks, unsigned nblks, const AES_KEY *key)
 {
     unsigned i, j, rnds = ROUNDS(key);
     const __m128i *sched = ((__m128i *) (key->rd_key));
@@ -74,13 +74,31 @@ AES_encrypt(const unsigned char *in, unsigned char *out, const AES_KEY *key);
 void
 AES_decrypt(const unsigned char *in, unsigned char *out, const AES_KEY *key);
 void
-AES_ecb_encrypt_blks(block *blks, unsigned nblks, AES_KEY *key);
+AES_ecb_encrypt_blks(block *blks, unsigned nblks, const AES_KEY *key);
 void
-AES_ecb_decrypt_blks(block *blks, unsigned nblks, AES_KEY *key);
+AES_ecb_encrypt_blks_4(block *blks, const AES_KEY *key);
+void
+AES_ecb_encrypt_blks_8(block *blks, const AES_KEY *key);
+void
+AES_ecb_decrypt_blks(block *blks, unsigned nblks, const AES_KEY *key);
 
 int
 AES_encrypt_message(const unsigned char *in, size_t inlength,
                     unsigned char *out, size_t outlength, const AES_KEY *key);
+void
+AES_encrypt_messages(const block *in, unsigned int nmsgs,
+                     unsigned char *out, size_t outlength, const AES_KEY *key);
+
+void
+AES_ctr_expand(const unsigned char *seed, unsigned char *out,
+               size_t outlength);
+
+void
+AES_set_fixed_key(AES_KEY *key);
+void
+AES_crhash_messages(const block *in, unsigned int nmsgs, unsigned int stride,
+                    unsigned long tweak, unsigned char *out, size_t outlength,
+                    const AES_KEY *key);
 
 
 #endif
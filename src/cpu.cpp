@@ -0,0 +1,38 @@
+#include "cpu.h"
+
+#include <stdlib.h>
+
+static int features = -1;
+
+static unsigned int
+detect(void)
+{
+    unsigned int f = 0;
+    const char *mask;
+
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        f |= CPU_AVX2;
+    if (__builtin_cpu_supports("avx512f")) {
+        if (__builtin_cpu_supports("vaes"))
+            f |= CPU_VAES;
+        if (__builtin_cpu_supports("vpclmulqdq"))
+            f |= CPU_VPCLMUL;
+    }
+    if ((mask = getenv(CPU_ENV)) != NULL && mask[0] != '\0')
+        f &= strtoul(mask, NULL, 0);
+    return f;
+}
+
+unsigned int
+cpu_features(void)
+{
+    int f = __atomic_load_n(&features, __ATOMIC_RELAXED);
+
+    /* racing first calls compute the same value */
+    if (f < 0) {
+        f = detect();
+        __atomic_store_n(&features, f, __ATOMIC_RELAXED);
+    }
+    return f;
+}
@@ -0,0 +1,30 @@
+#ifndef __OTLIB_CPU_H__
+#define __OTLIB_CPU_H__
+
+/*
+ * Optional instruction set extensions, detected at runtime so that one build
+ * runs everywhere AES-NI and PCLMULQDQ are available (the baseline the
+ * library is compiled for) and uses wider kernels where the CPU has them.
+ */
+
+#define CPU_ENV "OTLIB_CPU_FEATURES"
+
+#define CPU_AVX2 0x1            /* 256-bit integer SIMD */
+#define CPU_VAES 0x2            /* 512-bit AES (VAES with AVX-512F) */
+#define CPU_VPCLMUL 0x4         /* 512-bit PCLMULQDQ (with AVX-512F) */
+
+/*
+ * Returns the CPU_* flags supported by this CPU, masked by the value of the
+ * environment variable CPU_ENV if it is set (e.g., 0 forces the baseline
+ * kernels).  The result is computed once.
+ */
+unsigned int
+cpu_features(void);
+
+static inline int
+cpu_has(unsigned int feature)
+{
+    return (cpu_features() & feature) == feature;
+}
+
+#endif
@@ -1,13 +1,148 @@
 #include "crypto.h"
 
-#include <openssl/aes.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
 #include <openssl/sha.h>
 #include <string.h>
+#include <unistd.h>
+#include <sys/random.h>
 
 #include <wmmintrin.h>
 
 #include "utils.h"
 
+#define RANDFILE "/dev/urandom"
+
+/*
+ * Uses getrandom(2) when the kernel has it and falls back to reading RANDFILE.
+ */
+int
+random_seed(unsigned char *seed, size_t len)
+{
+    size_t n = 0;
+    int fd;
+
+    while (n < len) {
+        ssize_t r = getrandom(seed + n, len - n, 0);
+
+        if (r == -1 && errno == EINTR)
+            continue;
+        if (r == -1)
+            break;
+        n += r;
+    }
+    if (n == len)
+        return SUCCESS;
+
+    if ((fd = open(RANDFILE, O_RDONLY)) == -1) {
+        (void) fprintf(stderr, "Error opening %s\n", RANDFILE);
+        return FAILURE;
+    }
+    while (n < len) {
+        ssize_t r = read(fd, seed + n, len - n);
+
+        if (r == -1 && errno == EINTR)
+            continue;
+        if (r <= 0) {
+            (void) fprintf(stderr, "Error reading from %s\n", RANDFILE);
+            (void) close(fd);
+            return FAILURE;
+        }
+        n += r;
+    }
+    (void) close(fd);
+    return SUCCESS;
+}
+
+int
+prg_init(struct prg *prg, const unsigned char *seed)
+{
+    unsigned char key[PRG_SEEDLEN];
+
+    if (seed == NULL) {
+        if (random_seed(key, sizeof key) == FAILURE)
+            return FAILURE;
+        seed = key;
+    }
+    AES_set_encrypt_key(seed, 128, &prg->key);
+    prg->ctr = 0;
+    prg->pos = sizeof prg->buf;
+    (void) memset(key, '\0', sizeof key);
+    return SUCCESS;
+}
+
+/*
+ * Encrypts the next 'nblks' counter values into 'out'.
+ */
+static void
+prg_generate(struct prg *prg, block *out, unsigned int nblks)
+{
+    for (unsigned int i = 0; i < nblks; ++i)
+        out[i] = _mm_set_epi64x(0, (long long) prg->ctr++);
+    AES_ecb_encrypt_blks(out, nblks, &prg->key);
+}
+
+void
+prg_bytes(struct prg *prg, void *out, size_t len)
+{
+    unsigned char *p = (unsigned char *) out;
+    size_t n;
+
+    /* drain the buffer first, so that no output is ever handed out twice */
+    n = MIN(len, sizeof prg->buf - prg->pos);
+    (void) memcpy(p, (unsigned char *) prg->buf + prg->pos, n);
+    prg->pos += n;
+    p += n;
+    len -= n;
+
+    /* large requests bypass the buffer */
+    while (len >= sizeof prg->buf) {
+        block blks[PRG_NBLKS];
+
+        prg_generate(prg, blks, PRG_NBLKS);
+        (void) memcpy(p, blks, sizeof blks);
+        p += sizeof blks;
+        len -= sizeof blks;
+    }
+    if (len > 0) {
+        prg_generate(prg, prg->buf, PRG_NBLKS);
+        (void) memcpy(p, prg->buf, len);
+        prg->pos = len;
+    }
+}
+
+void
+prg_bits(struct prg *prg, unsigned char *out, size_t nbits)
+{
+    prg_bytes(prg, out, (nbits + 7) / 8);
+    if (nbits % 8)
+        out[nbits / 8] &= 0xff << (8 - nbits % 8);
+}
+
+block
+prg_block(struct prg *prg)
+{
+    block b;
+
+    prg_bytes(prg, &b, sizeof b);
+    return b;
+}
+
+unsigned long
+prg_uniform(struct prg *prg, unsigned long n)
+{
+    /* largest multiple of n representable, so that r % n is uniform */
+    const unsigned long limit = ULONG_MAX - ULONG_MAX % n;
+    unsigned long r;
+
+    assert(n > 0);
+    do {
+        prg_bytes(prg, &r, sizeof r);
+    } while (r >= limit);
+    return r % n;
+}
+
 /*
  * Implementation (heavily) inspired by computePermutation() function found at
  * http://daimi.au.dk/~jot2re/cuda/resources/code2.zip : src/OT/protocols.c,
@@ -15,7 +150,7 @@
  */
 int
 random_permutation(unsigned int *array, unsigned int size,
-                   unsigned int *sorted, unsigned int seed)
+                   unsigned int *sorted, struct prg *prg)
 {
     unsigned int *tmp;
 
@@ -23,8 +158,6 @@ random_permutation(unsigned int *array, unsigned int size,
     if (tmp == NULL)
         return FAILURE;
 
-    srand(seed);
-
     /* Initialize identity permutation */
     for (unsigned int i = 0; i < size; ++i) {
         tmp[i] = i;
@@ -34,7 +167,7 @@ random_permutation(unsigned int *array, unsigned int size,
     for (unsigned int i = size - 1; i >= 1; --i) {
         unsigned int j, tmpi, tmpj;
 
-        j = (unsigned int) rand() % (i + 1);
+        j = (unsigned int) prg_uniform(prg, i + 1);
         tmpi = tmp[i];
         tmpj = tmp[j];
         tmp[i] = tmpj;
@@ -131,22 +264,18 @@ void
 xorarray(unsigned char *a, const size_t alen,
          const unsigned char *b, const size_t blen)
 {
-    unsigned char tmp[16];
+    size_t i;
 
     assert(alen >= blen);
-    for (size_t i = 0; i < blen; i += 16) {
+    for (i = 0; i + 16 <= blen; i += 16) {
         __m128i am, bm;
-        int length = blen - i < 16 ? blen - i : 16;
-        
+
         am = _mm_loadu_si128((__m128i *) (a + i));
         bm = _mm_loadu_si128((__m128i *) (b + i));
         am = _mm_xor_si128(am, bm);
-        // _mm_store_si128((__m128i *) (a + i), am);
-        _mm_store_si128((__m128i *) tmp, am);
-        (void) memcpy(a + i, tmp, length);
+        _mm_storeu_si128((__m128i *) (a + i), am);
+    }
+    for (; i < blen; ++i) {
+        a[i] ^= b[i];
     }
-    // for (size_t i = 0; i < blen; ++i) {
-    //     a[i] ^= b[i];
-    // }
 }
-
@@ -1,12 +1,61 @@
 #ifndef __OTLIB_CRYPTO_H__
 #define __OTLIB_CRYPTO_H__
 
+#include "aes.h"
+
 #include <stdlib.h>
 #include <openssl/evp.h>
 
+#define PRG_SEEDLEN 16
+#define PRG_NBLKS 64            /* blocks generated per refill */
+
+/*
+ * Pseudorandom generator: AES-128 in counter mode under a random key, with
+ * the output produced PRG_NBLKS blocks at a time.  Not thread-safe; workers
+ * use their own generators seeded from a parent one.
+ */
+struct prg {
+    AES_KEY key;
+    unsigned long ctr;
+    unsigned int pos;           /* bytes of 'buf' already handed out */
+    block buf[PRG_NBLKS];
+};
+
+/*
+ * Reads 'len' bytes of entropy from the operating system.
+ */
+int
+random_seed(unsigned char *seed, size_t len);
+
+/*
+ * Keys 'prg' with the PRG_SEEDLEN byte 'seed', or with a fresh seed from the
+ * operating system if 'seed' is NULL.
+ */
+int
+prg_init(struct prg *prg, const unsigned char *seed);
+
+void
+prg_bytes(struct prg *prg, void *out, size_t len);
+
+/*
+ * Writes 'nbits' random bits to 'out', packed as in ot_set_choice(); the
+ * unused bits of the last byte are cleared.
+ */
+void
+prg_bits(struct prg *prg, unsigned char *out, size_t nbits);
+
+block
+prg_block(struct prg *prg);
+
+/*
+ * Samples a uniform integer in [0, n), n > 0, by rejection.
+ */
+unsigned long
+prg_uniform(struct prg *prg, unsigned long n);
+
 int
 random_permutation(unsigned int *array, unsigned int size,
-                   unsigned int *sorted, unsigned int seed);
+                   unsigned int *sorted, struct prg *prg);
 
 void
 sha1_hash(char *output, size_t outputlen, int counter,
@@ -1,233 +1,301 @@
 #include "ghash.h"
 
-#include <pthread.h>
-#include <emmintrin.h>
-#include <smmintrin.h>
-#include <x86intrin.h>
-#include <stdint.h>
-#include <stdio.h>
-#include <math.h>
-
-extern "C" {
-    void gfmul(__m128i k, __m128i in, __m128i *out);
-}
+#include "cpu.h"
+#include "threadpool.h"
+#include "utils.h"
 
-struct aes_block {
-    uint64_t a;
-    uint64_t b;
-};
-
-#define LEN (1<<16)
-#define LEN2 1
+#include <stdint.h>
+#include <immintrin.h>
 
 #define zero_block _mm_setzero_si128
 #define xor_block _mm_xor_si128
 
-#define STAMP ({unsigned res; __asm__ __volatile__ ("rdtsc" : "=a"(res) : : "edx"); res;})
-#define TIMES2 100
-#define TIMES 10
-#define NTHREADS 1
-int len = LEN;
-__m128i* mk;
-__m128i* mmsg;
-__m128i res1[NTHREADS];
-
-
-// static void
-// dbg(int j)
-// {
-//     printf("%d\n",j);
-// }
-
+/* smallest share of ghash_parallel() worth a job, in blocks */
+#define GHASH_MINPART 4096
+#define GHASH_MAXPARTS 64
 
 __m128i
-one_block()
+gf_reduce(const struct gf_wide *w)
 {
-    __m128i res = zero_block();
-    long *r = (long *) &res;
-    r[0] = 1;
-    return res;
+    __m128i lo, hi, t7, t8, t9;
+
+    lo = _mm_xor_si128(w->lo, _mm_slli_si128(w->mid, 8));
+    hi = _mm_xor_si128(w->hi, _mm_srli_si128(w->mid, 8));
+
+    /* shift <hi:lo> left by one bit, as the operands are bit-reflected */
+    t7 = _mm_srli_epi32(lo, 31);
+    t8 = _mm_srli_epi32(hi, 31);
+    lo = _mm_slli_epi32(lo, 1);
+    hi = _mm_slli_epi32(hi, 1);
+    t9 = _mm_srli_si128(t7, 12);
+    t8 = _mm_slli_si128(t8, 4);
+    t7 = _mm_slli_si128(t7, 4);
+    lo = _mm_or_si128(lo, t7);
+    hi = _mm_or_si128(hi, t8);
+    hi = _mm_or_si128(hi, t9);
+
+    /* reduce modulo x^128 + x^7 + x^2 + x + 1, as in gfmul */
+    t7 = _mm_xor_si128(_mm_slli_epi32(lo, 31), _mm_slli_epi32(lo, 30));
+    t7 = _mm_xor_si128(t7, _mm_slli_epi32(lo, 25));
+    t8 = _mm_srli_si128(t7, 4);
+    lo = _mm_xor_si128(lo, _mm_slli_si128(t7, 12));
+    t9 = _mm_xor_si128(_mm_srli_epi32(lo, 1), _mm_srli_epi32(lo, 2));
+    t9 = _mm_xor_si128(t9, _mm_srli_epi32(lo, 7));
+    t9 = _mm_xor_si128(t9, t8);
+    lo = _mm_xor_si128(lo, t9);
+    return _mm_xor_si128(hi, lo);
 }
 
-
 void
-powa(__m128i k, int n, __m128i *res)
+ghash_init_key(struct ghash_key *key, __m128i h)
 {
-    int i = 0;
-    __m128i tmp = one_block();
-    for (i = 1; i < n; i++)
-        gfmul(k, tmp, &tmp);
-    *res = tmp;
+    key->pow[0] = h;
+    for (int i = 1; i < GHASH_NPOWERS; ++i)
+        key->pow[i] = gf_mul(key->pow[i - 1], h);
+    for (int i = 0; i < GHASH_NPOWERS; ++i)
+        key->rpow[i] = key->pow[GHASH_NPOWERS - 1 - i];
 }
 
+/*
+ * Sums the four 128-bit lanes of 'z'.  The maskz extractions avoid the
+ * undefined source of the plain ones, which -Wall reports as uninitialized.
+ */
+__attribute__((target("avx512f")))
+static inline __m128i
+fold_lanes(__m512i z)
+{
+    __m256i t = _mm256_xor_si256(_mm512_maskz_extracti64x4_epi64(0xff, z, 0),
+                                 _mm512_maskz_extracti64x4_epi64(0xff, z, 1));
 
-void
-ghash3(__m128i k, __m128i* msg, int len, __m128i *res)
+    return _mm_xor_si128(_mm256_castsi256_si128(t),
+                         _mm256_extracti128_si256(t, 1));
+}
+
+/*
+ * 512-bit PCLMULQDQ version of gf_mul_add for four pairs at a time.  Returns
+ * the number of pairs added, a multiple of four.
+ */
+__attribute__((target("avx512f,vpclmulqdq")))
+static size_t
+gf_mul_add_n_vpclmul(struct gf_wide *w, const __m128i *a, const __m128i *b,
+                     size_t n)
 {
-    int i;
-    __m128i res1, temp;
-    for (i = 0; i < len; i++) {
-        temp = _mm_xor_si128(msg[i], res1);
-        gfmul(k, temp, &res1);
+    __m512i lo = _mm512_setzero_si512(), mid = lo, hi = lo;
+    size_t i;
+
+    for (i = 0; i + 4 <= n; i += 4) {
+        __m512i x = _mm512_loadu_si512(&a[i]), y = _mm512_loadu_si512(&b[i]);
+
+        lo = _mm512_xor_si512(lo, _mm512_clmulepi64_epi128(x, y, 0x00));
+        hi = _mm512_xor_si512(hi, _mm512_clmulepi64_epi128(x, y, 0x11));
+        mid = _mm512_xor_si512(mid, _mm512_clmulepi64_epi128(x, y, 0x10));
+        mid = _mm512_xor_si512(mid, _mm512_clmulepi64_epi128(x, y, 0x01));
     }
-    *res = res1;
+    w->lo = _mm_xor_si128(w->lo, fold_lanes(lo));
+    w->mid = _mm_xor_si128(w->mid, fold_lanes(mid));
+    w->hi = _mm_xor_si128(w->hi, fold_lanes(hi));
+    return i;
 }
 
+void
+gf_mul_add_n(struct gf_wide *w, const __m128i *a, const __m128i *b, size_t n)
+{
+    size_t i = 0;
+
+    if (cpu_has(CPU_VPCLMUL))
+        i = gf_mul_add_n_vpclmul(w, a, b, n);
+    for (; i < n; ++i)
+        gf_mul_add(w, _mm_loadu_si128(&a[i]), _mm_loadu_si128(&b[i]));
+}
 
 void
-ghash2(__m128i k, __m128i* msg, int len, __m128i *res)
+ghash_init(struct ghash_ctx *ctx, const struct ghash_key *key)
 {
-    int i;
-    __m128i res1,temp;
-    for (i = 0; i < len; i++) {
-        powa(k, len - i, &temp);
-        gfmul(temp, msg[i], &temp);
-        res1 = _mm_xor_si128(temp, res1);
-    }
-    *res = res1;
+    ctx->key = key;
+    ctx->acc = zero_block();
+    ctx->nbuf = 0;
 }
 
+/*
+ * acc = (acc + b_0) H^n + b_1 H^(n-1) + ... + b_(n-1) H, with one reduction.
+ */
+static void
+absorb(struct ghash_ctx *ctx, const __m128i *blks, unsigned int n)
+{
+    const __m128i *pow = ctx->key->pow;
+    struct gf_wide w;
+
+    gf_wide_zero(&w);
+    gf_mul_add(&w, xor_block(ctx->acc, _mm_loadu_si128(&blks[0])),
+               pow[n - 1]);
+    for (unsigned int i = 1; i < n; ++i)
+        gf_mul_add(&w, _mm_loadu_si128(&blks[i]), pow[n - 1 - i]);
+    ctx->acc = gf_reduce(&w);
+}
 
-void
-ghash(__m128i k, __m128i* msg, int len, __m128i *res)
+/*
+ * 512-bit PCLMULQDQ version of absorb() for 'ngroups' full groups.
+ */
+__attribute__((target("avx512f,vpclmulqdq")))
+static void
+absorb_groups_vpclmul(struct ghash_ctx *ctx, const __m128i *blks,
+                      size_t ngroups)
 {
-    int i;
-    __m128i res1, temp, temp2;
-    res1 = zero_block();
-    temp2 = one_block();
-    for (i = 0; i < len; i++) {
-        gfmul(temp2, msg[i], &temp);
-        res1 =  _mm_xor_si128(temp, res1);
-        gfmul(temp2, k, &temp2);
+    const __m512i p0 = _mm512_loadu_si512(&ctx->key->rpow[0]);
+    const __m512i p1 = _mm512_loadu_si512(&ctx->key->rpow[4]);
+    __m128i acc = ctx->acc;
+    struct gf_wide w;
+
+    for (size_t g = 0; g < ngroups; ++g, blks += GHASH_NPOWERS) {
+        __m512i x0 = _mm512_loadu_si512(&blks[0]);
+        __m512i x1 = _mm512_loadu_si512(&blks[4]);
+        __m512i lo, mid, hi;
+
+        x0 = _mm512_xor_si512(x0, _mm512_zextsi128_si512(acc));
+        lo = _mm512_xor_si512(_mm512_clmulepi64_epi128(x0, p0, 0x00),
+                              _mm512_clmulepi64_epi128(x1, p1, 0x00));
+        hi = _mm512_xor_si512(_mm512_clmulepi64_epi128(x0, p0, 0x11),
+                              _mm512_clmulepi64_epi128(x1, p1, 0x11));
+        mid = _mm512_xor_si512(_mm512_clmulepi64_epi128(x0, p0, 0x10),
+                               _mm512_clmulepi64_epi128(x1, p1, 0x10));
+        mid = _mm512_xor_si512(mid, _mm512_clmulepi64_epi128(x0, p0, 0x01));
+        mid = _mm512_xor_si512(mid, _mm512_clmulepi64_epi128(x1, p1, 0x01));
+        w.lo = fold_lanes(lo);
+        w.mid = fold_lanes(mid);
+        w.hi = fold_lanes(hi);
+        acc = gf_reduce(&w);
     }
-    *res = res1;
+    ctx->acc = acc;
 }
 
-
-void *
-ghashworker(void *ia)
+void
+ghash_update(struct ghash_ctx *ctx, const __m128i *blks, size_t nblks)
 {
-    int i = *((int *) ia);
-    int slen = len / NTHREADS;
-    int start = i*slen;
-    int j, k;
-    __m128i temp, temp2, tres;
-    powa(*mk, start, &temp2);
-    for (k = 0; k < TIMES; k++) {
-        tres = zero_block();
-        for (j = start; j < start + slen; j++) {
-            gfmul(temp2, mmsg[j], &temp);
-            tres =  xor_block(temp, tres);
-            gfmul(temp2, *mk, &temp2);
+    /* complete a group started by an earlier call */
+    while (nblks > 0 && ctx->nbuf > 0) {
+        ctx->buf[ctx->nbuf++] = _mm_loadu_si128(blks++);
+        --nblks;
+        if (ctx->nbuf == GHASH_NPOWERS) {
+            absorb(ctx, ctx->buf, GHASH_NPOWERS);
+            ctx->nbuf = 0;
         }
-        res1[i] = tres;
     }
-    return NULL;
+    if (nblks >= GHASH_NPOWERS && cpu_has(CPU_VPCLMUL)) {
+        const size_t ngroups = nblks / GHASH_NPOWERS;
+
+        absorb_groups_vpclmul(ctx, blks, ngroups);
+        blks += ngroups * GHASH_NPOWERS;
+        nblks -= ngroups * GHASH_NPOWERS;
+    }
+    for (; nblks >= GHASH_NPOWERS; nblks -= GHASH_NPOWERS) {
+        absorb(ctx, blks, GHASH_NPOWERS);
+        blks += GHASH_NPOWERS;
+    }
+    for (; nblks > 0; --nblks)
+        ctx->buf[ctx->nbuf++] = _mm_loadu_si128(blks++);
 }
 
 void
-ghashworker2(int start, int slen, __m128i *res)
+ghash_final(struct ghash_ctx *ctx, __m128i *res)
 {
-    int j  =start;
-    __m128i temp, temp2, r1;
-    r1 = zero_block();
-    powa(*mk, start, &temp2);
-    for (j = start; j < start + slen; j++) {
-        gfmul(temp2, mmsg[j], &temp);
-        r1 =  xor_block(temp, r1);
-        powa(*mk, j + 1, &temp2);
-    }
-    *res = r1;
+    if (ctx->nbuf > 0)
+        absorb(ctx, ctx->buf, ctx->nbuf);
+    ctx->nbuf = 0;
+    *res = ctx->acc;
 }
 
 void
-ghashsplit(__m128i k, __m128i* msg, int len, __m128i *res)
+ghash(__m128i k, __m128i* msg, int len, __m128i *res)
 {
-    int i;
-    // __m128i temp2;
-    // temp2 = k;
-    mk = &k;
-    mmsg = msg;
-
-    int tids[NTHREADS];
-    pthread_t threads[NTHREADS];
-    pthread_attr_t attr;
-
-    /* Pthreads setup: initialize mutex and explicitly create threads in a
-       joinable state (for portability).  Pass each thread its loop offset */
-    pthread_attr_init(&attr);
-    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
-    for (i=0; i<NTHREADS; i++) {
-        tids[i] = i;
-        res1[i] = zero_block();
-        pthread_create(&threads[i], &attr, ghashworker, (void *) &tids[i]);
-        //     ghashworker((void *) &tids[i]);
-    }
-    for (i=0; i<NTHREADS; i++) {
-        pthread_join(threads[i], NULL);
+    struct ghash_key key;
+    struct ghash_ctx ctx;
+
+    ghash_init_key(&key, k);
+    ghash_init(&ctx, &key);
+    ghash_update(&ctx, msg, len);
+    ghash_final(&ctx, res);
+}
+
+
+/*
+ * h^e, by square and multiply.
+ */
+__m128i
+gf_pow(__m128i h, unsigned long e)
+{
+    /* the field's one is the top bit in the bit-reflected representation */
+    __m128i res = _mm_set_epi64x(INT64_MIN, 0);
+
+    for (; e > 0; e >>= 1) {
+        if (e & 1)
+            res = gf_mul(res, h);
+        h = gf_mul(h, h);
     }
+    return res;
+}
 
-    *res = zero_block();
-    for (i=0;i<NTHREADS;i++)
-        *res = xor_block( res1[i], *res);
+struct ghash_part {
+    const struct ghash_key *key;
+    const __m128i *msg;
+    size_t len;
+    unsigned long shift;        /* number of blocks after this part */
+    __m128i res;
+    struct completion done;
+};
+
+/*
+ * Hashes one part and scales it by H^shift, its weight in the full GHASH.
+ */
+static void
+ghash_part_job(void *arg)
+{
+    struct ghash_part *part = (struct ghash_part *) arg;
+    struct ghash_ctx ctx;
+
+    ghash_init(&ctx, part->key);
+    ghash_update(&ctx, part->msg, part->len);
+    ghash_final(&ctx, &part->res);
+    part->res = gf_mul(part->res, gf_pow(part->key->pow[0], part->shift));
+    completion_signal(&part->done);
 }
 
 void
-ghashsplitold(__m128i k, __m128i* msg, int len, __m128i *res)
+ghash_parallel(struct threadpool *pool, __m128i k, const __m128i *msg,
+               size_t len, __m128i *res)
 {
-    int i;
-    __m128i temp2;
-    temp2 = k;
-    mk = &k;
-    mmsg = msg;
-
-    int start = 0;
-    int end = len;
-    int split = (end-start)/NTHREADS;
-    int slen;
-
-    for (i = 0; i < NTHREADS; i++) {
-        if (end-start > split)
-            slen = split;
-        else
-            slen = end-start;
-        if (i !=0)
-            res1[i] = zero_block();//res1[i-1];
-        ghashworker((void *)&i);
-        start = start+slen;
+    struct ghash_part parts[GHASH_MAXPARTS];
+    struct ghash_key key;
+    size_t nparts, off = 0;
+
+    nparts = MIN(MAX(threadpool_nthreads(pool), 1), GHASH_MAXPARTS);
+    nparts = MIN(nparts, len / GHASH_MINPART);
+
+    ghash_init_key(&key, k);
+    if (nparts <= 1) {
+        struct ghash_ctx ctx;
+
+        ghash_init(&ctx, &key);
+        ghash_update(&ctx, msg, len);
+        ghash_final(&ctx, res);
+        return;
     }
-    *res = zero_block();
-    for (i = 0; i < NTHREADS; i++)
-        *res = xor_block( res1[i], *res);
 
+    for (size_t i = 0; i < nparts; ++i) {
+        struct ghash_part *part = &parts[i];
+
+        part->key = &key;
+        part->msg = msg + off;
+        part->len = len / nparts + (i < len % nparts);
+        off += part->len;
+        part->shift = len - off;
+        completion_init(&part->done);
+        if (threadpool_add_job(pool, ghash_part_job, part) == FAILURE)
+            ghash_part_job(part);
+    }
+    *res = zero_block();
+    for (size_t i = 0; i < nparts; ++i) {
+        completion_wait(&parts[i].done);
+        *res = xor_block(*res, parts[i].res);
+        completion_cleanup(&parts[i].done);
+    }
 }
-
-// int
-// main()
-// {
-//     __m128i a,b,c,d;
-//     __m128i* arr = (__m128i *)malloc(sizeof(__m128i)*LEN);
-//     long *c2 = (long *)&c;
-//     long *d2 = (long *)&d;
-
-//     unsigned long t1,t2;
-//     gfmul(a,b,&c);
-//     int i,j;
-//     double min = 200;
-//     // ghashsplit(a,arr,LEN,&d);
-//     if ((c2[0] == d2[0]) && (c2[1] == d2[1]))
-//         printf("Worked!\n");
-
-//     for (j=0;j<TIMES2;j++){
-//         t1 = STAMP;
-//         //	  for (i=0;i<TIMES;i++){
-//         ghashsplit(a,arr,LEN,&c);
-//         //	  }
-//         t2 = STAMP;
-
-//         double dx = ((t2-t1)*1.0f/(TIMES*LEN*16));
-//         if (dx < min) min = dx;
-//     }
-//     printf("%lf",min);
-
-// }
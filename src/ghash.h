@@ -1,8 +1,119 @@
 #ifndef _GHASH_
 #define _GHASH_
 
+#include <stddef.h>
 #include <wmmintrin.h>
+#include <emmintrin.h>
 
+extern "C" {
+    void gfmul(__m128i k, __m128i in, __m128i *out);
+}
+
+/*
+ * GHASH in GF(2^128), in the bit-reflected representation used by gfmul,
+ * with aggregated reduction [1]: blocks are absorbed GHASH_NPOWERS at a time
+ * by multiplying them with the precomputed powers of H and summing the
+ * unreduced products, so that a group costs a single reduction.
+ *
+ * [1] "Intel Carry-Less Multiplication Instruction and its Usage for Computing
+ *     the GCM Mode."  S. Gueron, M.E. Kounavis.  Intel white paper, 2014.
+ */
+
+#define GHASH_NPOWERS 8
+
+struct ghash_key {
+    __m128i pow[GHASH_NPOWERS]; /* pow[i] = H^(i+1) */
+    __m128i rpow[GHASH_NPOWERS]; /* rpow[i] = H^(GHASH_NPOWERS-i) */
+};
+
+struct ghash_ctx {
+    const struct ghash_key *key;
+    __m128i acc;
+    __m128i buf[GHASH_NPOWERS]; /* blocks not absorbed yet */
+    unsigned int nbuf;
+};
+
+/*
+ * Unreduced product of two field elements, kept as its low, middle and high
+ * 128-bit parts so that several products can be summed before reducing.
+ */
+struct gf_wide {
+    __m128i lo, mid, hi;
+};
+
+static inline void
+gf_wide_zero(struct gf_wide *w)
+{
+    w->lo = w->mid = w->hi = _mm_setzero_si128();
+}
+
+/*
+ * Adds the carry-less product a * b to 'w'.
+ */
+static inline void
+gf_mul_add(struct gf_wide *w, __m128i a, __m128i b)
+{
+    w->lo = _mm_xor_si128(w->lo, _mm_clmulepi64_si128(a, b, 0x00));
+    w->hi = _mm_xor_si128(w->hi, _mm_clmulepi64_si128(a, b, 0x11));
+    w->mid = _mm_xor_si128(w->mid, _mm_clmulepi64_si128(a, b, 0x10));
+    w->mid = _mm_xor_si128(w->mid, _mm_clmulepi64_si128(a, b, 0x01));
+}
+
+/*
+ * Reduces 'w' to a field element; gf_reduce of a single product a * b equals
+ * gfmul(a, b).
+ */
+__m128i
+gf_reduce(const struct gf_wide *w);
+
+/*
+ * Adds the products a[i] * b[i], i < n, to 'w'; uses 512-bit PCLMULQDQ when
+ * available.
+ */
+void
+gf_mul_add_n(struct gf_wide *w, const __m128i *a, const __m128i *b, size_t n);
+
+static inline __m128i
+gf_mul(__m128i a, __m128i b)
+{
+    struct gf_wide w;
+
+    gf_wide_zero(&w);
+    gf_mul_add(&w, a, b);
+    return gf_reduce(&w);
+}
+
+void
+ghash_init_key(struct ghash_key *key, __m128i h);
+
+void
+ghash_init(struct ghash_ctx *ctx, const struct ghash_key *key);
+
+void
+ghash_update(struct ghash_ctx *ctx, const __m128i *blks, size_t nblks);
+
+void
+ghash_final(struct ghash_ctx *ctx, __m128i *res);
+
+__m128i
+gf_pow(__m128i h, unsigned long e);
+
+/*
+ * One-shot GHASH: res = sum_i msg[i] * k^(len - i).
+ */
 void ghash (__m128i k, __m128i* msg, int len, __m128i *res);
 
+struct threadpool;
+
+/*
+ * Same as ghash(), with the input split into contiguous parts hashed by the
+ * workers of 'pool'.  Part p is weighted by k^(number of blocks after it), so
+ * the result does not depend on the number of workers.  Safe to call from
+ * several threads at once, but not from a job of 'pool': the caller blocks
+ * until its parts are done, which deadlocks once every worker waits so.
+ */
+void
+ghash_parallel(struct threadpool *pool, __m128i k, const __m128i *msg,
+               size_t len, __m128i *res);
+
 #endif
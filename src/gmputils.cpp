@@ -1,96 +1,216 @@
 #include "gmputils.h"
 
-#include "state.h"
 #include "utils.h"
 
 #include <string.h>
 
+/*
+ * Samples a uniform nonzero scalar in Z_q.
+ */
 void
-random_element(mpz_t out, struct params *p)
+random_scalar(scalar out, struct params *p)
 {
-    mpz_urandomb(out, p->rnd, field_size * 8);
-    mpz_mod(out, out, p->p);
-}
-
-void
-mpz_to_array(char *buf, const mpz_t n, const size_t buflen)
-{
-    size_t len = 0;
-    memset(buf, '\0', buflen);
-    (void) mpz_export(buf, &len, -1, sizeof(char), 0, 0, n);
+    do {
+        mpz_prg_urandomm(out, &p->rnd, p->q);
+    } while (mpz_sgn(out) == 0);
 }
 
 void
-array_to_mpz(mpz_t out, const char *buf, const size_t buflen)
+mpz_prg_urandomb(mpz_t out, struct prg *prg, unsigned long nbits)
 {
-    mpz_import(out, buflen, -1, sizeof(char), 0, 0, buf);
+    const size_t len = (nbits + 7) / 8;
+    unsigned char buf[len];
+
+    prg_bytes(prg, buf, len);
+    if (nbits % 8)
+        buf[0] &= 0xff >> (8 - nbits % 8);
+    mpz_import(out, len, 1, 1, 0, 0, buf);
+    (void) memset(buf, '\0', len);
 }
 
 void
-find_generator(mpz_t g, struct params *params)
+mpz_prg_urandomm(mpz_t out, struct prg *prg, const mpz_t n)
 {
-    mpz_t exp, pminusone, tmp;
+    const unsigned long nbits = mpz_sizeinbase(n, 2);
 
-    mpz_inits(exp, pminusone, tmp, NULL);
-    mpz_sub_ui(pminusone, params->p, 1);
-    mpz_div_ui(exp, pminusone, 2);
     do {
-        random_element(g, params);
-        /* XXX: this assumes q is a safe prime */
-        mpz_powm(tmp, g, exp, params->p);
-    } while (mpz_cmp(tmp, pminusone) != 0);
-
-    mpz_clears(exp, pminusone, tmp, NULL);
+        mpz_prg_urandomb(out, prg, nbits);
+    } while (mpz_cmp(out, n) >= 0);
 }
 
+/*
+ * Builds the table of powers of 'base' modulo 'mod' for exponents of at most
+ * 'expbits' bits.
+ */
 int
-encode(mpz_t elem, const char *str, size_t strlen, const struct params *p)
+fbtable_init(struct fbtable *t, const mpz_t base, const mpz_t mod,
+             unsigned int expbits)
 {
-    mpz_t exp, rop;
-
-    mpz_inits(exp, rop, NULL);
+    const unsigned int size = 1 << FBTABLE_WINDOW;
+    mpz_t b;
 
-    if (strlen >= field_size)
+    t->nwindows = (expbits + FBTABLE_WINDOW - 1) / FBTABLE_WINDOW;
+    t->mapped = 0;
+    t->table = (mpz_t *) malloc(sizeof(mpz_t) * t->nwindows * size);
+    if (t->table == NULL)
         return FAILURE;
-    mpz_import(elem, strlen, -1, sizeof str[0], 0, 0, str);
-    mpz_add_ui(elem, elem, 1);
-
-    /* compute (p - 1) / 2 */
-    mpz_sub_ui(exp, p->p, 1);
-    mpz_divexact_ui(exp, exp, 2);
-    /* compute elem ^ exp mod p */
-    mpz_powm(rop, elem, exp, p->p);
-
-    if (mpz_cmp_ui(rop, 1) != 0) {
-        mpz_neg(elem, elem);
-        mpz_mod(elem, elem, p->p);
+
+    /* b = base^(2^(i * FBTABLE_WINDOW)) for window i */
+    mpz_init_set(b, base);
+    for (unsigned int i = 0; i < t->nwindows; ++i) {
+        mpz_t *row = t->table + i * size;
+
+        mpz_init_set_ui(row[0], 1);
+        for (unsigned int d = 1; d < size; ++d) {
+            mpz_init(row[d]);
+            mpz_mul(row[d], row[d - 1], b);
+            mpz_mod(row[d], row[d], mod);
+        }
+        mpz_mul(b, row[size - 1], b);
+        mpz_mod(b, b, mod);
     }
+    mpz_clear(b);
 
-    mpz_clears(exp, rop, NULL);
+    return SUCCESS;
+}
 
+/*
+ * Sets up a table over entries already laid out in 'limbs', 'nlimbs' limbs per
+ * entry in the order built by fbtable_init().  The entries are used in place,
+ * so 'limbs' must outlive the table.
+ */
+int
+fbtable_map(struct fbtable *t, const mp_limb_t *limbs, size_t nlimbs,
+            unsigned int expbits)
+{
+    t->nwindows = (expbits + FBTABLE_WINDOW - 1) / FBTABLE_WINDOW;
+    t->mapped = 1;
+    t->table = (mpz_t *) malloc(sizeof(mpz_t) * (t->nwindows << FBTABLE_WINDOW));
+    if (t->table == NULL)
+        return FAILURE;
+    for (unsigned int i = 0; i < t->nwindows << FBTABLE_WINDOW; ++i)
+        (void) mpz_roinit_n(t->table[i], limbs + i * nlimbs, nlimbs);
     return SUCCESS;
 }
 
-char *
-decode(const mpz_t elem, const struct params *p)
+void
+fbtable_clear(struct fbtable *t)
+{
+    if (t->table == NULL)
+        return;
+    for (unsigned int i = 0; !t->mapped && i < t->nwindows << FBTABLE_WINDOW;
+         ++i)
+        mpz_clear(t->table[i]);
+    free(t->table);
+    t->table = NULL;
+}
+
+/*
+ * Computes base^exp modulo 'mod'.  Exponents that are negative or do not fit
+ * in the table fall back to mpz_powm() on the base, table entry 1.
+ */
+void
+fbtable_powm(mpz_t out, const struct fbtable *t, const mpz_t exp,
+             const mpz_t mod)
 {
-    mpz_t tmp;
-    char *out;
+    unsigned char digits[t->nwindows];
     size_t count = 0;
 
-    mpz_init(tmp);
+    if (mpz_sgn(exp) < 0 || mpz_sizeinbase(exp, 256) > t->nwindows) {
+        mpz_powm(out, t->table[1], exp, mod);
+        return;
+    }
 
-    if (mpz_cmp(elem, p->q) <= 0) {
-        mpz_sub_ui(tmp, elem, 1);
-    } else {
-        mpz_neg(tmp, elem);
-        mpz_mod(tmp, tmp, p->p);
-        mpz_sub_ui(tmp, tmp, 1);
+    /* with 8-bit windows, the digits are the little-endian bytes of exp */
+    (void) memset(digits, '\0', sizeof digits);
+    (void) mpz_export(digits, &count, -1, 1, 0, 0, exp);
+
+    mpz_set_ui(out, 1);
+    for (unsigned int i = 0; i < t->nwindows; ++i) {
+        if (digits[i] == 0)
+            continue;
+        mpz_mul(out, out, t->table[(i << FBTABLE_WINDOW) + digits[i]]);
+        mpz_mod(out, out, mod);
+    }
+}
+
+/*
+ * Computes a^x * b^y modulo 'mod' for nonnegative 'x' and 'y' with Straus'
+ * interleaving: the exponents are scanned together POWM2_WINDOW bits at a
+ * time, so the squarings are shared and each window costs one multiplication
+ * by a precomputed a^i b^j.
+ */
+void
+mpz_powm2(mpz_t out, const mpz_t a, const mpz_t x, const mpz_t b,
+          const mpz_t y, const mpz_t mod)
+{
+    const unsigned int n = 1 << POWM2_WINDOW;
+    mpz_t table[1 << (2 * POWM2_WINDOW)], acc;
+    size_t bits, nwindows;
+
+    assert(mpz_sgn(x) >= 0 && mpz_sgn(y) >= 0);
+
+    /* table[i * n + j] = a^i b^j */
+    mpz_init_set_ui(table[0], 1);
+    for (unsigned int i = 0; i < n; ++i) {
+        for (unsigned int j = 0; j < n; ++j) {
+            mpz_t *t = &table[i * n + j];
+
+            if (i == 0 && j == 0)
+                continue;
+            mpz_init(*t);
+            if (j == 0)
+                mpz_mul(*t, table[(i - 1) * n], a);
+            else
+                mpz_mul(*t, table[i * n + j - 1], b);
+            mpz_mod(*t, *t, mod);
+        }
     }
 
-    out = (char *) mpz_export(NULL, &count, -1, sizeof(char), 0, 0, tmp);
+    bits = MAX(mpz_sizeinbase(x, 2), mpz_sizeinbase(y, 2));
+    nwindows = (bits + POWM2_WINDOW - 1) / POWM2_WINDOW;
+
+    mpz_init_set_ui(acc, 1);
+    for (size_t w = nwindows; w-- > 0;) {
+        unsigned int i = 0, j = 0;
+
+        for (int k = POWM2_WINDOW - 1; k >= 0; --k) {
+            mpz_mul(acc, acc, acc);
+            mpz_mod(acc, acc, mod);
+            i = (i << 1) | mpz_tstbit(x, w * POWM2_WINDOW + k);
+            j = (j << 1) | mpz_tstbit(y, w * POWM2_WINDOW + k);
+        }
+        if (i | j) {
+            mpz_mul(acc, acc, table[i * n + j]);
+            mpz_mod(acc, acc, mod);
+        }
+    }
+    mpz_swap(out, acc);
+
+    mpz_clear(acc);
+    for (unsigned int i = 0; i < n * n; ++i)
+        mpz_clear(table[i]);
+}
+
+void
+mpz_to_array(char *buf, const mpz_t n, const size_t buflen)
+{
+    size_t len = 0;
+    memset(buf, '\0', buflen);
+    (void) mpz_export(buf, &len, -1, sizeof(char), 0, 0, n);
+}
 
-    mpz_clear(tmp);
+void
+array_to_mpz(mpz_t out, const char *buf, const size_t buflen)
+{
+    mpz_import(out, buflen, -1, sizeof(char), 0, 0, buf);
+}
 
-    return out;
+int
+in_subgroup(const mpz_t x, mpz_t tmp, const struct params *p)
+{
+    if (mpz_cmp_ui(x, 1) <= 0 || mpz_cmp(x, p->p) >= 0)
+        return 0;
+    mpz_powm(tmp, x, p->q, p->p);
+    return mpz_cmp_ui(tmp, 1) == 0;
 }
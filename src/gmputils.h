@@ -1,33 +1,91 @@
 #ifndef __OTLIB_GMPUTILS_H__
 #define __OTLIB_GMPUTILS_H__
 
+#include "crypto.h"
+
 #include <gmp.h>
 
 #define FIELD_SIZE 128          /* the field size in bytes */
 
+/*
+ * Fixed-base exponentiation table: entry i * 2^FBTABLE_WINDOW + d holds
+ * base^(d * 2^(i * FBTABLE_WINDOW)), so that base^e costs one multiplication
+ * per nonzero window of e.
+ */
+#define FBTABLE_WINDOW 8
+
+/*
+ * Window size, in bits of each exponent, of the interleaved double
+ * exponentiation in mpz_powm2().
+ */
+#define POWM2_WINDOW 2
+
+struct fbtable {
+    unsigned int nwindows;
+    int mapped;                 /* entries point into read-only memory */
+    mpz_t *table;
+};
+
 struct params {
     mpz_t p;
     mpz_t g;
     mpz_t q;
-    gmp_randstate_t rnd;
+    struct prg rnd;
+    struct fbtable gtab;        /* powers of g, for exponents mod q */
 };
 
-void
-random_element(mpz_t out, struct params *p);
+/*
+ * Exponents are scalars in Z_q, where q is the (160-bit) order of the
+ * subgroup generated by g; all protocol group elements live in that subgroup.
+ * The typedef keeps them apart from 1024-bit group elements in declarations.
+ */
+typedef mpz_t scalar;
 
 void
-mpz_to_array(char *buf, const mpz_t n, const size_t buflen);
+random_scalar(scalar out, struct params *p);
 
+/*
+ * Samples a uniform integer of at most 'nbits' bits from 'prg'.
+ */
 void
-array_to_mpz(mpz_t out, const char *buf, const size_t buflen);
+mpz_prg_urandomb(mpz_t out, struct prg *prg, unsigned long nbits);
 
+/*
+ * Samples a uniform integer in [0, n) from 'prg', by rejection.
+ */
 void
-find_generator(mpz_t g, struct params *params);
+mpz_prg_urandomm(mpz_t out, struct prg *prg, const mpz_t n);
+
+int
+fbtable_init(struct fbtable *t, const mpz_t base, const mpz_t mod,
+             unsigned int expbits);
 
 int
-encode(mpz_t elem, const char *str, size_t strlen, const struct params *p);
+fbtable_map(struct fbtable *t, const mp_limb_t *limbs, size_t nlimbs,
+            unsigned int expbits);
+
+void
+fbtable_clear(struct fbtable *t);
 
-char *
-decode(const mpz_t elem, const struct params *p);
+void
+fbtable_powm(mpz_t out, const struct fbtable *t, const mpz_t exp,
+             const mpz_t mod);
+
+void
+mpz_powm2(mpz_t out, const mpz_t a, const mpz_t x, const mpz_t b,
+          const mpz_t y, const mpz_t mod);
+
+void
+mpz_to_array(char *buf, const mpz_t n, const size_t buflen);
+
+void
+array_to_mpz(mpz_t out, const char *buf, const size_t buflen);
+
+/*
+ * Checks that 'x' is a group element other than 1 in the order-q subgroup.
+ * 'tmp' is scratch space.
+ */
+int
+in_subgroup(const mpz_t x, mpz_t tmp, const struct params *p);
 
 #endif
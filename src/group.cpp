@@ -0,0 +1,230 @@
+#include "group.h"
+
+#include "state.h"
+#include "utils.h"
+
+#include <string.h>
+
+#include <openssl/bn.h>
+#include <openssl/obj_mac.h>
+
+#define EC_SCALARLEN 32
+
+/*
+ * Converts a scalar to a BIGNUM for the EC backend.
+ */
+static BIGNUM *
+scalar_to_bn(const scalar s)
+{
+    unsigned char buf[EC_SCALARLEN];
+    size_t count = 0;
+
+    assert(mpz_sizeinbase(s, 256) <= sizeof buf);
+    (void) mpz_export(buf, &count, 1, 1, 0, 0, s);
+    return BN_bin2bn(buf, count, NULL);
+}
+
+int
+group_init(struct group *g, enum group_type type, struct params *p)
+{
+    g->type = type;
+    g->p = p;
+    g->ec = NULL;
+    mpz_init(g->order);
+
+    switch (type) {
+    case GROUP_FF:
+        g->elemlen = field_size;
+        mpz_set(g->order, p->q);
+        break;
+    case GROUP_EC: {
+        BIGNUM *order;
+        unsigned char buf[EC_SCALARLEN];
+
+        g->ec = EC_GROUP_new_by_curve_name(NID_X9_62_prime256v1);
+        if (g->ec == NULL)
+            return FAILURE;
+        /* compressed points */
+        g->elemlen = 1 + EC_SCALARLEN;
+        order = BN_new();
+        if (order == NULL || !EC_GROUP_get_order(g->ec, order, NULL)
+            || BN_bn2binpad(order, buf, sizeof buf) != sizeof buf) {
+            BN_free(order);
+            return FAILURE;
+        }
+        mpz_import(g->order, sizeof buf, 1, 1, 0, 0, buf);
+        BN_free(order);
+        break;
+    }
+    default:
+        return FAILURE;
+    }
+    return SUCCESS;
+}
+
+void
+group_cleanup(struct group *g)
+{
+    if (g->ec)
+        EC_GROUP_free(g->ec);
+    mpz_clear(g->order);
+}
+
+int
+group_elem_init(const struct group *g, struct group_elem *e)
+{
+    e->ec = NULL;
+    mpz_init(e->ff);
+    if (g->type == GROUP_EC) {
+        e->ec = EC_POINT_new(g->ec);
+        if (e->ec == NULL)
+            return FAILURE;
+    }
+    return SUCCESS;
+}
+
+void
+group_elem_clear(const struct group *g, struct group_elem *e)
+{
+    mpz_clear(e->ff);
+    if (e->ec)
+        EC_POINT_free(e->ec);
+}
+
+void
+group_random_scalar(const struct group *g, scalar s, struct prg *rnd)
+{
+    do {
+        mpz_prg_urandomm(s, rnd, g->order);
+    } while (mpz_sgn(s) == 0);
+}
+
+int
+group_exp_base(const struct group *g, struct group_elem *out, const scalar s)
+{
+    switch (g->type) {
+    case GROUP_FF:
+        fbtable_powm(out->ff, &g->p->gtab, s, g->p->p);
+        return SUCCESS;
+    case GROUP_EC: {
+        BIGNUM *bn = scalar_to_bn(s);
+        int ok;
+
+        ok = bn && EC_POINT_mul(g->ec, out->ec, bn, NULL, NULL, NULL);
+        BN_free(bn);
+        return ok ? SUCCESS : FAILURE;
+    }
+    default:
+        return FAILURE;
+    }
+}
+
+int
+group_exp(const struct group *g, struct group_elem *out,
+          const struct group_elem *a, const scalar s)
+{
+    switch (g->type) {
+    case GROUP_FF:
+        mpz_powm(out->ff, a->ff, s, g->p->p);
+        return SUCCESS;
+    case GROUP_EC: {
+        BIGNUM *bn = scalar_to_bn(s);
+        int ok;
+
+        ok = bn && EC_POINT_mul(g->ec, out->ec, NULL, a->ec, bn, NULL);
+        BN_free(bn);
+        return ok ? SUCCESS : FAILURE;
+    }
+    default:
+        return FAILURE;
+    }
+}
+
+int
+group_mul(const struct group *g, struct group_elem *out,
+          const struct group_elem *a, const struct group_elem *b)
+{
+    switch (g->type) {
+    case GROUP_FF:
+        mpz_mul(out->ff, a->ff, b->ff);
+        mpz_mod(out->ff, out->ff, g->p->p);
+        return SUCCESS;
+    case GROUP_EC:
+        return EC_POINT_add(g->ec, out->ec, a->ec, b->ec, NULL)
+            ? SUCCESS : FAILURE;
+    default:
+        return FAILURE;
+    }
+}
+
+int
+group_inv(const struct group *g, struct group_elem *out,
+          const struct group_elem *a)
+{
+    switch (g->type) {
+    case GROUP_FF:
+        return mpz_invert(out->ff, a->ff, g->p->p) ? SUCCESS : FAILURE;
+    case GROUP_EC:
+        if (!EC_POINT_copy(out->ec, a->ec))
+            return FAILURE;
+        return EC_POINT_invert(g->ec, out->ec, NULL) ? SUCCESS : FAILURE;
+    default:
+        return FAILURE;
+    }
+}
+
+void
+group_set(const struct group *g, struct group_elem *out,
+          const struct group_elem *a)
+{
+    if (g->type == GROUP_EC)
+        (void) EC_POINT_copy(out->ec, a->ec);
+    else
+        mpz_set(out->ff, a->ff);
+}
+
+int
+group_to_bytes(const struct group *g, unsigned char *buf,
+               const struct group_elem *e)
+{
+    switch (g->type) {
+    case GROUP_FF:
+        mpz_to_array((char *) buf, e->ff, g->elemlen);
+        return SUCCESS;
+    case GROUP_EC:
+        return EC_POINT_point2oct(g->ec, e->ec, POINT_CONVERSION_COMPRESSED,
+                                  buf, g->elemlen, NULL) == g->elemlen
+            ? SUCCESS : FAILURE;
+    default:
+        return FAILURE;
+    }
+}
+
+int
+group_from_bytes(const struct group *g, struct group_elem *e,
+                 const unsigned char *buf)
+{
+    switch (g->type) {
+    case GROUP_FF: {
+        mpz_t tmp;
+        int ok;
+
+        array_to_mpz(e->ff, (const char *) buf, g->elemlen);
+        if (mpz_cmp_ui(e->ff, 1) <= 0 || mpz_cmp(e->ff, g->p->p) >= 0)
+            return FAILURE;
+        /* reject elements outside the order-q subgroup */
+        mpz_init(tmp);
+        mpz_powm(tmp, e->ff, g->order, g->p->p);
+        ok = mpz_cmp_ui(tmp, 1) == 0;
+        mpz_clear(tmp);
+        return ok ? SUCCESS : FAILURE;
+    }
+    case GROUP_EC:
+        /* oct2point checks that the point is on the curve */
+        if (!EC_POINT_oct2point(g->ec, e->ec, buf, g->elemlen, NULL))
+            return FAILURE;
+        return EC_POINT_is_at_infinity(g->ec, e->ec) ? FAILURE : SUCCESS;
+    default:
+        return FAILURE;
+    }
+}
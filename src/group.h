@@ -0,0 +1,90 @@
+#ifndef __OTLIB_GROUP_H__
+#define __OTLIB_GROUP_H__
+
+#include <gmp.h>
+#include <openssl/ec.h>
+
+#include "gmputils.h"
+
+/*
+ * Prime-order groups for the public-key OTs.  Elements are written
+ * multiplicatively (for the elliptic curve, "multiplication" is point
+ * addition) and exponents are scalars modulo the group order.
+ *
+ * Only Chou-Orlandi OT runs over this interface.  Naor-Pinkas and PVW still
+ * work on the 1024-bit field directly through struct params, as they rely on
+ * its fixed-base tables, batched inversions and double exponentiation.
+ */
+enum group_type {
+    GROUP_FF,                   /* order-q subgroup of the 1024-bit field */
+    GROUP_EC,                   /* NIST P-256 */
+    GROUP_NTYPES
+};
+
+struct group {
+    enum group_type type;
+    size_t elemlen;             /* bytes per serialized element */
+    mpz_t order;
+    struct params *p;           /* GROUP_FF */
+    EC_GROUP *ec;               /* GROUP_EC */
+};
+
+struct group_elem {
+    mpz_t ff;                   /* GROUP_FF */
+    EC_POINT *ec;               /* GROUP_EC */
+};
+
+int
+group_init(struct group *g, enum group_type type, struct params *p);
+
+void
+group_cleanup(struct group *g);
+
+int
+group_elem_init(const struct group *g, struct group_elem *e);
+
+void
+group_elem_clear(const struct group *g, struct group_elem *e);
+
+void
+group_random_scalar(const struct group *g, scalar s, struct prg *rnd);
+
+/* out = generator^s */
+int
+group_exp_base(const struct group *g, struct group_elem *out, const scalar s);
+
+/* out = a^s */
+int
+group_exp(const struct group *g, struct group_elem *out,
+          const struct group_elem *a, const scalar s);
+
+/* out = a * b */
+int
+group_mul(const struct group *g, struct group_elem *out,
+          const struct group_elem *a, const struct group_elem *b);
+
+/* out = a^-1 */
+int
+group_inv(const struct group *g, struct group_elem *out,
+          const struct group_elem *a);
+
+void
+group_set(const struct group *g, struct group_elem *out,
+          const struct group_elem *a);
+
+/*
+ * Writes 'e' to 'buf', which holds g->elemlen bytes.
+ */
+int
+group_to_bytes(const struct group *g, unsigned char *buf,
+               const struct group_elem *e);
+
+/*
+ * Reads an element from 'buf', failing unless it is a non-identity element of
+ * the prime-order group (for GROUP_FF, of the order-q subgroup).
+ */
+int
+group_from_bytes(const struct group *g, struct group_elem *e,
+                 const unsigned char *buf);
+
+#endif
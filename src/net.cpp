@@ -1,4 +1,5 @@
 #include "net.h"
+#include "utils.h"
 
 #include <errno.h>
 #include <netdb.h>
@@ -116,16 +117,16 @@ sendall(int s, char *buf, size_t len)
 {
     size_t total = 0;
     size_t bytesleft = len;
-    int n;
+    ssize_t n;
 
     while (total < len) {
         n = send(s, buf + total, bytesleft, 0);
         if (n == -1)
-            break;
+            return -1;
         total += n;
         bytesleft -= n;
     }
-    return n == -1 ? -1 : 0;
+    return 0;
 }
 
 int
@@ -133,16 +134,135 @@ recvall(int s, char *buf, size_t len)
 {
     size_t total = 0;
     size_t bytesleft = len;
-    int n;
+    ssize_t n;
 
     while (total < len) {
         n = recv(s, buf + total, bytesleft, 0);
-        if (n == -1)
-            break;
+        if (n <= 0)
+            return -1;
         total += n;
         bytesleft -= n;
     }
-    return n == -1 ? -1 : 0;
+    return 0;
+}
+
+int
+channel_init(struct channel *ch, int fd, size_t bufsize)
+{
+    (void) memset(ch, '\0', sizeof(struct channel));
+    ch->fd = fd;
+    ch->bufsize = bufsize;
+    ch->sbuf = (char *) malloc(bufsize);
+    if (ch->sbuf == NULL)
+        return -1;
+    ch->rbuf = (char *) malloc(bufsize);
+    if (ch->rbuf == NULL) {
+        free(ch->sbuf);
+        ch->sbuf = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+void
+channel_cleanup(struct channel *ch)
+{
+    if (ch->sbuf)
+        free(ch->sbuf);
+    if (ch->rbuf)
+        free(ch->rbuf);
+    ch->sbuf = ch->rbuf = NULL;
+}
+
+static int
+channel_write(struct channel *ch, const char *buf, size_t len)
+{
+    size_t total = 0;
+    ssize_t n;
+
+    while (total < len) {
+        n = send(ch->fd, buf + total, len - total, 0);
+        if (n == -1)
+            return -1;
+        ch->nsends++;
+        total += n;
+    }
+    ch->bytes_sent += len;
+    return 0;
+}
+
+int
+channel_flush(struct channel *ch)
+{
+    if (ch->slen == 0)
+        return 0;
+    if (channel_write(ch, ch->sbuf, ch->slen) == -1)
+        return -1;
+    ch->slen = 0;
+    return 0;
+}
+
+int
+channel_send(struct channel *ch, const void *buf, size_t len)
+{
+    if (ch->slen + len > ch->bufsize) {
+        if (channel_flush(ch) == -1)
+            return -1;
+        /* large writes bypass the buffer */
+        if (len >= ch->bufsize)
+            return channel_write(ch, (const char *) buf, len);
+    }
+    (void) memcpy(ch->sbuf + ch->slen, buf, len);
+    ch->slen += len;
+    return 0;
+}
+
+int
+channel_recv(struct channel *ch, void *buf, size_t len)
+{
+    char *out = (char *) buf;
+    ssize_t n;
+
+    /* the other party may be waiting on data we have not yet sent */
+    if (channel_flush(ch) == -1)
+        return -1;
+
+    while (len > 0) {
+        size_t avail = ch->rlen - ch->rpos;
+
+        if (avail > 0) {
+            size_t nbytes = MIN(avail, len);
+            (void) memcpy(out, ch->rbuf + ch->rpos, nbytes);
+            ch->rpos += nbytes;
+            out += nbytes;
+            len -= nbytes;
+        } else if (len >= ch->bufsize) {
+            /* large reads bypass the buffer */
+            n = recv(ch->fd, out, len, 0);
+            if (n <= 0)
+                return -1;
+            ch->nrecvs++;
+            ch->bytes_recv += n;
+            out += n;
+            len -= n;
+        } else {
+            n = recv(ch->fd, ch->rbuf, ch->bufsize, 0);
+            if (n <= 0)
+                return -1;
+            ch->nrecvs++;
+            ch->bytes_recv += n;
+            ch->rpos = 0;
+            ch->rlen = n;
+        }
+    }
+    return 0;
+}
+
+void
+channel_print_stats(const struct channel *ch, const char *tag)
+{
+    fprintf(stderr, "%s: sent %lu bytes in %lu calls, received %lu bytes in %lu calls\n",
+            tag, ch->bytes_sent, ch->nsends, ch->bytes_recv, ch->nrecvs);
 }
 
 // int
@@ -5,6 +5,29 @@
 
 #define BACKLOG 5
 
+#define CHANNEL_BUFSIZE (1 << 18) /* default channel buffer size in bytes */
+
+/*
+ * Buffered channel over a connected socket.  Outgoing data is coalesced into
+ * 'sbuf' and written once the buffer fills up, when channel_flush() is
+ * called, or before blocking on incoming data.  Incoming data is read into
+ * 'rbuf' in as large chunks as the socket provides.
+ */
+struct channel {
+    int fd;
+    size_t bufsize;
+    char *sbuf;
+    size_t slen;
+    char *rbuf;
+    size_t rpos;
+    size_t rlen;
+    /* statistics */
+    unsigned long bytes_sent;
+    unsigned long bytes_recv;
+    unsigned long nsends;       /* number of send() calls */
+    unsigned long nrecvs;       /* number of recv() calls */
+};
+
 void *
 get_in_addr(const struct sockaddr *sa);
 
@@ -20,6 +43,24 @@ sendall(int s, char *buf, size_t len);
 int
 recvall(int s, char *buf, size_t len);
 
+int
+channel_init(struct channel *ch, int fd, size_t bufsize);
+
+void
+channel_cleanup(struct channel *ch);
+
+int
+channel_send(struct channel *ch, const void *buf, size_t len);
+
+int
+channel_flush(struct channel *ch);
+
+int
+channel_recv(struct channel *ch, void *buf, size_t len);
+
+void
+channel_print_stats(const struct channel *ch, const char *tag);
+
 /* int */
 /* pysend(int socket, const void *buffer, size_t length, int flags); */
 
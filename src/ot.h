@@ -5,16 +5,34 @@
 #include <unistd.h>
 
 /*
- * Function for getting a pointer to the 'idx'th OT from 'msgs'
+ * Buffer conventions shared by the native OT APIs:
+ *
+ * - Messages for 1-out-of-N OTs are stored contiguously with a fixed stride
+ *   of 'maxlength' bytes: message i of OT j lives at offset
+ *   (j * N + i) * maxlength.  Shorter messages are zero-padded.
+ *
+ * - 1-out-of-2 choices are packed into a bitvector, most-significant bit
+ *   first, so that choice j is bit (7 - j % 8) of byte j / 8.
+ *
+ * - 1-out-of-N choices (N <= 256) are stored one byte per OT.
+ *
+ * - Received messages are written to a caller-provided buffer, with message j
+ *   at offset j * maxlength.
  */
-typedef void * (*ot_msg_reader)(void *msgs, int idx);
-/*
- * Function for reading the 'idx'th message in the OT 'item'
- */
-typedef void (*ot_item_reader)(void *item, int idx, void *m, ssize_t *mlen);
 
-typedef int (*ot_choice_reader)(void *choices, int idx);
+static inline int
+ot_get_choice(const unsigned char *choices, long idx)
+{
+    return (choices[idx / 8] >> (7 - idx % 8)) & 1;
+}
 
-typedef int (*ot_msg_writer)(void *array, int idx, void *msg, size_t maxlength);
+static inline void
+ot_set_choice(unsigned char *choices, long idx, int bit)
+{
+    if (bit)
+        choices[idx / 8] |= 1 << (7 - idx % 8);
+    else
+        choices[idx / 8] &= ~(1 << (7 - idx % 8));
+}
 
 #endif
@@ -0,0 +1,286 @@
+/*
+ * Implementation of the "simplest" OT of Chou and Orlandi [1], generalized to
+ * 1-out-of-N as in the paper.
+ *
+ * The sender publishes A = g^a; the receiver with choice c sends
+ * B = A^c g^b and derives its key from A^b = (B / A^c)^a.  The sender derives
+ * the key for message i from (B / A^i)^a = B^a / T^i, where T = A^a.
+ *
+ * [1] "The Simplest Protocol for Oblivious Transfer."
+ *     T. Chou, C. Orlandi. LATINCRYPT 2015.
+ */
+#include "ot_co.h"
+
+#include "crypto.h"
+#include "net.h"
+#include "utils.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <openssl/evp.h>
+#include <openssl/sha.h>
+#include "aes.h"
+
+#define ERROR { err = 1; goto cleanup; }
+
+/*
+ * Derives a 'outlen' byte pad for branch 'i' from the key element 'K' of the
+ * OT whose messages are A and B.  As in ot_np.cpp, the elements are hashed
+ * to one block with SHA-256 and expanded with the fixed-key hash.
+ */
+static void
+hash_key(unsigned char *out, size_t outlen, int i, const unsigned char *A,
+         const unsigned char *B, const unsigned char *K, size_t elemlen,
+         const AES_KEY *key)
+{
+    unsigned char digest[SHA256_DIGEST_LENGTH];
+    EVP_MD_CTX *ctx;
+    block seed;
+
+    ctx = EVP_MD_CTX_new();
+    (void) EVP_DigestInit_ex(ctx, EVP_sha256(), NULL);
+    (void) EVP_DigestUpdate(ctx, A, elemlen);
+    (void) EVP_DigestUpdate(ctx, B, elemlen);
+    (void) EVP_DigestUpdate(ctx, K, elemlen);
+    (void) EVP_DigestFinal_ex(ctx, digest, NULL);
+    EVP_MD_CTX_free(ctx);
+    seed = _mm_loadu_si128((__m128i *) digest);
+    AES_crhash_messages(&seed, 1, 1, i, out, outlen, key);
+}
+
+int
+ot_co_send(struct state *st, enum group_type type, const unsigned char *msgs,
+           int maxlength, int num_ots, int N)
+{
+    const struct group *g = &st->groups[type];
+    const size_t elemlen = g->elemlen;
+    struct group_elem A, B, K, Ki, *Tinvs = NULL;
+    scalar a;
+    unsigned char *Abuf = NULL, *Bbuf = NULL, *Kbuf = NULL, *msg = NULL;
+    int err = 0, ntinvs = 0;
+    double start, end;
+
+    start = current_time();
+
+    mpz_init(a);
+    (void) group_elem_init(g, &A);
+    (void) group_elem_init(g, &B);
+    (void) group_elem_init(g, &K);
+    (void) group_elem_init(g, &Ki);
+
+    Abuf = (unsigned char *) ot_malloc(elemlen);
+    Bbuf = (unsigned char *) ot_malloc(elemlen);
+    Kbuf = (unsigned char *) ot_malloc(elemlen);
+    msg = (unsigned char *) ot_malloc(maxlength);
+    Tinvs = (struct group_elem *) ot_malloc(sizeof(struct group_elem) * N);
+    if (Abuf == NULL || Bbuf == NULL || Kbuf == NULL || msg == NULL
+        || Tinvs == NULL)
+        ERROR;
+
+    // choose a \in_R Zq and compute A = g^a
+    group_random_scalar(g, a, &st->p.rnd);
+    if (group_exp_base(g, &A, a) == FAILURE)
+        ERROR;
+    if (group_to_bytes(g, Abuf, &A) == FAILURE)
+        ERROR;
+    // compute T^-i for T = A^a
+    for (ntinvs = 0; ntinvs < N; ++ntinvs) {
+        if (group_elem_init(g, &Tinvs[ntinvs]) == FAILURE)
+            ERROR;
+    }
+    if (N > 1) {
+        if (group_exp(g, &Tinvs[1], &A, a) == FAILURE
+            || group_inv(g, &Tinvs[1], &Tinvs[1]) == FAILURE)
+            ERROR;
+        for (int i = 2; i < N; ++i) {
+            if (group_mul(g, &Tinvs[i], &Tinvs[i - 1], &Tinvs[1]) == FAILURE)
+                ERROR;
+        }
+    }
+    end = current_time();
+    fprintf(stderr, "Initialization: %f\n", end - start);
+
+    if (channel_send(&st->ch, Abuf, elemlen) == -1)
+        ERROR;
+
+    start = current_time();
+    for (int j = 0; j < num_ots; ++j) {
+        // get B from receiver
+        if (channel_recv(&st->ch, Bbuf, elemlen) == -1)
+            ERROR;
+        if (group_from_bytes(g, &B, Bbuf) == FAILURE) {
+            (void) fprintf(stderr, "invalid group element from receiver\n");
+            ERROR;
+        }
+        // compute K = B^a
+        if (group_exp(g, &K, &B, a) == FAILURE)
+            ERROR;
+
+        for (int i = 0; i < N; ++i) {
+            const unsigned char *item = msgs + ((long) j * N + i) * maxlength;
+
+            // key i is B^a / T^i
+            if (i == 0) {
+                group_set(g, &Ki, &K);
+            } else if (group_mul(g, &Ki, &K, &Tinvs[i]) == FAILURE) {
+                ERROR;
+            }
+            if (group_to_bytes(g, Kbuf, &Ki) == FAILURE)
+                ERROR;
+            hash_key(msg, maxlength, i, Abuf, Bbuf, Kbuf, elemlen,
+                     &st->aeskey);
+            xorarray(msg, maxlength, item, maxlength);
+            if (channel_send(&st->ch, msg, maxlength) == -1)
+                ERROR;
+        }
+    }
+    if (channel_flush(&st->ch) == -1)
+        ERROR;
+    end = current_time();
+    fprintf(stderr, "Compute and send ciphertexts: %f\n", end - start);
+
+ cleanup:
+    if (Tinvs) {
+        for (int i = 0; i < ntinvs; ++i)
+            group_elem_clear(g, &Tinvs[i]);
+        ot_free(Tinvs);
+    }
+    group_elem_clear(g, &A);
+    group_elem_clear(g, &B);
+    group_elem_clear(g, &K);
+    group_elem_clear(g, &Ki);
+    mpz_clear(a);
+    if (Abuf)
+        ot_free(Abuf);
+    if (Bbuf)
+        ot_free(Bbuf);
+    if (Kbuf)
+        ot_free(Kbuf);
+    if (msg)
+        ot_free(msg);
+
+    return err;
+}
+
+int
+ot_co_recv(struct state *st, enum group_type type, const unsigned char *choices,
+           int nchoices, int maxlength, int N, unsigned char *out)
+{
+    const struct group *g = &st->groups[type];
+    const size_t elemlen = g->elemlen;
+    struct group_elem A, B, K, *Apows = NULL;
+    scalar b;
+    unsigned char *Abuf = NULL, *Bbufs = NULL, *Kbufs = NULL, *msgs = NULL;
+    unsigned char *pad = NULL;
+    int err = 0, napows = 0;
+    double start, end;
+
+    /* a choice of N or more would index past 'Apows' and the ciphertexts */
+    for (int j = 0; j < nchoices; ++j) {
+        if (choices[j] >= N) {
+            (void) fprintf(stderr, "invalid choice %d for OT %d\n",
+                           choices[j], j);
+            return 1;
+        }
+    }
+
+    mpz_init(b);
+    (void) group_elem_init(g, &A);
+    (void) group_elem_init(g, &B);
+    (void) group_elem_init(g, &K);
+
+    Abuf = (unsigned char *) ot_malloc(elemlen);
+    Bbufs = (unsigned char *) ot_malloc(elemlen * nchoices);
+    Kbufs = (unsigned char *) ot_malloc(elemlen * nchoices);
+    msgs = (unsigned char *) ot_malloc((long) N * maxlength);
+    pad = (unsigned char *) ot_malloc(maxlength);
+    Apows = (struct group_elem *) ot_malloc(sizeof(struct group_elem) * N);
+    if (Abuf == NULL || Bbufs == NULL || Kbufs == NULL || msgs == NULL
+        || pad == NULL || Apows == NULL)
+        ERROR;
+
+    // get A from sender
+    start = current_time();
+    if (channel_recv(&st->ch, Abuf, elemlen) == -1)
+        ERROR;
+    if (group_from_bytes(g, &A, Abuf) == FAILURE) {
+        (void) fprintf(stderr, "invalid group element from sender\n");
+        ERROR;
+    }
+    end = current_time();
+    fprintf(stderr, "Get A from sender: %f\n", end - start);
+
+    // compute A^i for each choice i > 0
+    for (napows = 0; napows < N; ++napows) {
+        if (group_elem_init(g, &Apows[napows]) == FAILURE)
+            ERROR;
+    }
+    if (N > 1)
+        group_set(g, &Apows[1], &A);
+    for (int i = 2; i < N; ++i) {
+        if (group_mul(g, &Apows[i], &Apows[i - 1], &A) == FAILURE)
+            ERROR;
+    }
+
+    start = current_time();
+    for (int j = 0; j < nchoices; ++j) {
+        unsigned char *Bbuf = Bbufs + (long) j * elemlen;
+        int choice = choices[j];
+
+        // choose b \in_R Zq, and compute B = A^c g^b and K = A^b
+        group_random_scalar(g, b, &st->p.rnd);
+        if (group_exp_base(g, &B, b) == FAILURE)
+            ERROR;
+        if (choice != 0 && group_mul(g, &B, &B, &Apows[choice]) == FAILURE)
+            ERROR;
+        if (group_exp(g, &K, &A, b) == FAILURE)
+            ERROR;
+        if (group_to_bytes(g, Bbuf, &B) == FAILURE
+            || group_to_bytes(g, Kbufs + (long) j * elemlen, &K) == FAILURE)
+            ERROR;
+        if (channel_send(&st->ch, Bbuf, elemlen) == -1)
+            ERROR;
+    }
+    end = current_time();
+    fprintf(stderr, "Send Bs to sender: %f\n", end - start);
+
+    start = current_time();
+    for (int j = 0; j < nchoices; ++j) {
+        int choice = choices[j];
+
+        if (channel_recv(&st->ch, msgs, (long) N * maxlength) == -1)
+            ERROR;
+        // only the chosen branch can be decrypted
+        hash_key(pad, maxlength, choice, Abuf, Bbufs + (long) j * elemlen,
+                 Kbufs + (long) j * elemlen, elemlen, &st->aeskey);
+        (void) memcpy(out + (long) j * maxlength,
+                      msgs + (long) choice * maxlength, maxlength);
+        xorarray(out + (long) j * maxlength, maxlength, pad, maxlength);
+    }
+    end = current_time();
+    fprintf(stderr, "Receive and decrypt: %f\n", end - start);
+
+ cleanup:
+    if (Apows) {
+        for (int i = 0; i < napows; ++i)
+            group_elem_clear(g, &Apows[i]);
+        ot_free(Apows);
+    }
+    group_elem_clear(g, &A);
+    group_elem_clear(g, &B);
+    group_elem_clear(g, &K);
+    mpz_clear(b);
+    if (Abuf)
+        ot_free(Abuf);
+    if (Bbufs)
+        ot_free(Bbufs);
+    if (Kbufs)
+        ot_free(Kbufs);
+    if (msgs)
+        ot_free(msgs);
+    if (pad)
+        ot_free(pad);
+
+    return err;
+}
@@ -0,0 +1,25 @@
+#ifndef __OTLIB_OT_CO_H__
+#define __OTLIB_OT_CO_H__
+
+#include "group.h"
+#include "ot.h"
+#include "state.h"
+
+/*
+ * Runs the sender side of 'num_ots' 1-out-of-N OTs over the group 'type'.
+ * 'msgs' holds num_ots * N messages of 'maxlength' bytes each (see ot.h).
+ */
+int
+ot_co_send(struct state *st, enum group_type type, const unsigned char *msgs,
+           int maxlength, int num_ots, int N);
+
+/*
+ * Runs the receiver side of 'nchoices' 1-out-of-N OTs over the group 'type'.
+ * 'choices' holds one byte per OT and the chosen messages are written to
+ * 'out', which must hold nchoices * maxlength bytes.
+ */
+int
+ot_co_recv(struct state *st, enum group_type type, const unsigned char *choices,
+           int nchoices, int maxlength, int N, unsigned char *out);
+
+#endif
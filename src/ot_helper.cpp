@@ -21,7 +21,7 @@ ot_helper_random_seed(PyObject *self, PyObject *args)
         return NULL;
 
     mpz_init(r);
-    mpz_urandomb(r, st->p.rnd, length);
+    mpz_prg_urandomb(r, &st->p.rnd, length);
     str = mpz_get_str(NULL, 2, r);
     mpz_clear(r);
 
@@ -12,6 +12,7 @@
 #include "log.h"
 #include "net.h"
 #include "state.h"
+#include "threadpool.h"
 #include "utils.h"
 
 #include <errno.h>
@@ -20,72 +21,311 @@
 #include <string.h>
 
 #include <gmp.h>
+#include <openssl/evp.h>
 #include <openssl/sha.h>
 #include "aes.h"
 
-#define SHA
+#define ERROR { err = 1; goto cleanup; }
 
-#if !defined AES_HW && !defined SHA
-#error one of AES_HW, SHA must be defined
-#endif
+#define NP_CHUNK 32             /* number of OTs handled per job */
+/*
+ * Number of chunks of pk0s the receiver may have outstanding: the sender
+ * returns the ciphertexts of chunk c once it has received chunk
+ * c + NP_WINDOW, so both parties compute while the other's data is in flight.
+ */
+#define NP_WINDOW 8
 
-#define ERROR { err = 1; goto cleanup; }
+/*
+ * A chunk of OTs handled by one worker.  Each slot has its own scratch
+ * integers and, on the receiver, its own random stream, so workers share
+ * nothing mutable.
+ */
+struct np_slot {
+    const struct state *st;
+    int N;
+    int maxlength;
+    int j0;                     /* first OT of the chunk */
+    int n;                      /* number of OTs in the chunk */
+    /* sender */
+    const mpz_t *r;
+    const mpz_t *Crs;
+    const unsigned char *msgs;
+    unsigned char *buf;         /* ciphertexts of the chunk */
+    int err;                    /* set if a pk0 of the chunk was invalid */
+    /* receiver */
+    const mpz_t *gr;
+    const mpz_t *Cs;
+    const unsigned char *choices;
+    unsigned char *pads;        /* pad of every OT, maxlength bytes each */
+    char *pk0s;                 /* pk0s of the chunk, field_size bytes each */
+    struct prg rnd;
+    mpz_t x, y, z;
+    mpz_t *v;                   /* per-OT values of the chunk */
+    mpz_t *pre;                 /* prefix products for batch inversion */
+    struct completion done;
+};
+
+/*
+ * Derives a 'outlen' byte pad from the group element in 'buf' for branch
+ * 'i'.  A fixed-key permutation cannot soundly compress a 1024-bit element,
+ * so the element is first reduced to one block with a single SHA-256 call;
+ * the expansion to 'outlen' bytes uses the fixed-key hash.
+ */
+static void
+hash_element(unsigned char *out, size_t outlen, int i,
+             const char *buf, size_t buflen, const AES_KEY *key)
+{
+    unsigned char digest[SHA256_DIGEST_LENGTH];
+    block seed;
+
+    (void) EVP_Digest(buf, buflen, digest, NULL, EVP_sha256(), NULL);
+    seed = _mm_loadu_si128((__m128i *) digest);
+    AES_crhash_messages(&seed, 1, 1, i, out, outlen, key);
+}
+
+/*
+ * Replaces each of the 'n' elements of 'v' by its inverse modulo p using
+ * Montgomery's trick: one inversion and 3(n - 1) multiplications.  'pre' is
+ * scratch space for 'n' prefix products.  Fails, leaving 'v' unchanged, if
+ * some element has no inverse.
+ */
+static int
+batch_invert(mpz_t *v, mpz_t *pre, int n, mpz_t inv, mpz_t tmp,
+             const mpz_t p)
+{
+    // pre[k] = v_0 * ... * v_k
+    for (int k = 0; k < n; ++k) {
+        if (k == 0) {
+            mpz_set(pre[k], v[k]);
+        } else {
+            mpz_mul(pre[k], pre[k - 1], v[k]);
+            mpz_mod(pre[k], pre[k], p);
+        }
+    }
+    if (mpz_invert(inv, pre[n - 1], p) == 0)
+        return FAILURE;
+    for (int k = n - 1; k >= 0; --k) {
+        // inv = (v_0 ... v_k)^-1, so v_k^-1 = inv * (v_0 ... v_{k-1})
+        if (k > 0) {
+            mpz_mul(tmp, inv, pre[k - 1]);
+            mpz_mod(tmp, tmp, p);
+        } else {
+            mpz_set(tmp, inv);
+        }
+        mpz_mul(inv, inv, v[k]);
+        mpz_mod(inv, inv, p);
+        mpz_swap(v[k], tmp);
+    }
+    return SUCCESS;
+}
+
+static void
+np_send_job(void *arg)
+{
+    struct np_slot *slot = (struct np_slot *) arg;
+    const struct params *p = &slot->st->p;
+    const int N = slot->N, maxlength = slot->maxlength;
+    char buf[field_size];
+
+    // compute pk0^r and hash branch 0
+    for (int k = 0; k < slot->n; ++k) {
+        const int j = slot->j0 + k;
+        unsigned char *msg = slot->buf + (long) k * N * maxlength;
+
+        array_to_mpz(slot->x, slot->pk0s + (long) k * field_size, field_size);
+        // a pk0 outside the subgroup would let the receiver learn r, or
+        // with pk0 = 0 strip the pads of all branches
+        if (!in_subgroup(slot->x, slot->y, p)) {
+            slot->err = 1;
+            goto done;
+        }
+        mpz_powm(slot->v[k], slot->x, *slot->r, p->p);
+        mpz_to_array(buf, slot->v[k], sizeof buf);
+        hash_element(msg, maxlength, 0, buf, sizeof buf, &slot->st->aeskey);
+        xorarray(msg, maxlength, slot->msgs + (long) j * N * maxlength,
+                 maxlength);
+    }
+    if (N > 1 && batch_invert(slot->v, slot->pre, slot->n, slot->y, slot->z,
+                              p->p) == FAILURE) {
+        slot->err = 1;
+        goto done;
+    }
+    // the remaining branches use C_i^r / pk0^r
+    for (int k = 0; k < slot->n; ++k) {
+        const int j = slot->j0 + k;
+
+        for (int i = 1; i < N; ++i) {
+            const unsigned char *item = slot->msgs
+                + ((long) j * N + i) * maxlength;
+            unsigned char *msg = slot->buf + ((long) k * N + i) * maxlength;
+
+            mpz_mul(slot->z, slot->v[k], slot->Crs[i - 1]);
+            mpz_mod(slot->z, slot->z, p->p);
+            mpz_to_array(buf, slot->z, sizeof buf);
+            hash_element(msg, maxlength, i, buf, sizeof buf,
+                         &slot->st->aeskey);
+            xorarray(msg, maxlength, item, maxlength);
+        }
+    }
+ done:
+    completion_signal(&slot->done);
+}
+
+static void
+np_recv_job(void *arg)
+{
+    struct np_slot *slot = (struct np_slot *) arg;
+    const struct params *p = &slot->st->p;
+    char buf[field_size];
+
+    for (int k = 0; k < slot->n; ++k) {
+        const int j = slot->j0 + k;
+        const int choice = slot->choices[j];
+
+        // choose random k \in Zq from this slot's stream
+        do {
+            mpz_prg_urandomm(slot->x, &slot->rnd, p->q);
+        } while (mpz_sgn(slot->x) == 0);
+        // compute pks = g^k using the precomputed powers of g
+        fbtable_powm(slot->y, &p->gtab, slot->x, p->p);
+        // compute pk0 = C_choice / g^k even if our choice is 0 to avoid a
+        // potential side-channel attack
+        (void) mpz_invert(slot->z, slot->y, p->p);
+        mpz_mul(slot->z, slot->z, slot->Cs[choice == 0 ? 0 : choice - 1]);
+        mpz_mod(slot->z, slot->z, p->p);
+        mpz_to_array(slot->pk0s + (long) k * field_size,
+                     choice == 0 ? slot->y : slot->z, field_size);
+
+        // compute decryption key (g^r)^k; only the chosen branch can be
+        // decrypted
+        mpz_powm(slot->y, *slot->gr, slot->x, p->p);
+        mpz_to_array(buf, slot->y, sizeof buf);
+        hash_element(slot->pads + (long) j * slot->maxlength, slot->maxlength,
+                     choice, buf, sizeof buf, &slot->st->aeskey);
+    }
+    completion_signal(&slot->done);
+}
+
+static void
+free_slots(struct np_slot *slots, unsigned int nslots)
+{
+    if (slots == NULL)
+        return;
+    for (unsigned int i = 0; i < nslots; ++i) {
+        if (slots[i].buf)
+            ot_free(slots[i].buf);
+        if (slots[i].pk0s)
+            ot_free(slots[i].pk0s);
+        for (int k = 0; slots[i].v && k < NP_CHUNK; ++k)
+            mpz_clear(slots[i].v[k]);
+        for (int k = 0; slots[i].pre && k < NP_CHUNK; ++k)
+            mpz_clear(slots[i].pre[k]);
+        if (slots[i].v)
+            ot_free(slots[i].v);
+        if (slots[i].pre)
+            ot_free(slots[i].pre);
+        mpz_clears(slots[i].x, slots[i].y, slots[i].z, NULL);
+        completion_cleanup(&slots[i].done);
+    }
+    ot_free(slots);
+}
+
+/*
+ * Allocates 'nslots' slots, each with a random stream seeded from the state's
+ * generator, room for the pk0s of a chunk and, if 'buflen' is nonzero, an
+ * output buffer of 'buflen' bytes.
+ */
+static struct np_slot *
+alloc_slots(unsigned int nslots, struct state *st, int N, int maxlength,
+            size_t buflen)
+{
+    struct np_slot *slots;
+    unsigned char seed[PRG_SEEDLEN];
+
+    slots = (struct np_slot *) ot_malloc(sizeof(struct np_slot) * nslots);
+    if (slots == NULL)
+        return NULL;
+    (void) memset(slots, '\0', sizeof(struct np_slot) * nslots);
+    for (unsigned int i = 0; i < nslots; ++i) {
+        struct np_slot *slot = &slots[i];
+
+        slot->st = st;
+        slot->N = N;
+        slot->maxlength = maxlength;
+        mpz_inits(slot->x, slot->y, slot->z, NULL);
+        prg_bytes(&st->p.rnd, seed, sizeof seed);
+        (void) prg_init(&slot->rnd, seed);
+        completion_init(&slot->done);
+    }
+    (void) memset(seed, '\0', sizeof seed);
+    for (unsigned int i = 0; i < nslots; ++i) {
+        slots[i].pk0s = (char *) ot_malloc((size_t) NP_CHUNK * field_size);
+        slots[i].v = (mpz_t *) ot_malloc(sizeof(mpz_t) * NP_CHUNK);
+        slots[i].pre = (mpz_t *) ot_malloc(sizeof(mpz_t) * NP_CHUNK);
+        if (buflen)
+            slots[i].buf = (unsigned char *) ot_malloc(buflen);
+        for (int k = 0; slots[i].v && k < NP_CHUNK; ++k)
+            mpz_init(slots[i].v[k]);
+        for (int k = 0; slots[i].pre && k < NP_CHUNK; ++k)
+            mpz_init(slots[i].pre[k]);
+        if (slots[i].pk0s == NULL || slots[i].v == NULL
+            || slots[i].pre == NULL || (buflen && slots[i].buf == NULL)) {
+            free_slots(slots, nslots);
+            return NULL;
+        }
+    }
+    return slots;
+}
 
 /*
  * Runs sender operations for Naor-Pinkas semi-honest OT
  */
 int
-ot_np_send(struct state *st, void *msgs, int maxlength, int num_ots, int N,
-           ot_msg_reader ot_msg_reader, ot_item_reader ot_item_reader)
+ot_np_send(struct state *st, const unsigned char *msgs, int maxlength,
+           int num_ots, int N)
 {
-    mpz_t r, gr, pk, pk0;
-    mpz_t *Cs = NULL, *Crs = NULL, *pk0s = NULL;
-    char buf[field_size], *msg = NULL;
+    scalar r, c;
+    mpz_t gr;
+    mpz_t *Cs = NULL, *Crs = NULL;
+    char buf[field_size];
+    struct np_slot *slots = NULL;
+    const unsigned int nslots = NP_WINDOW + 1;
+    const int nchunks = (num_ots + NP_CHUNK - 1) / NP_CHUNK;
     int err = 0;
     double start, end;
 
-#ifdef AES_HW
-    fprintf(stderr, "OT-NP: Using AESNI\n");
-#endif
-#ifdef SHA
-    fprintf(stderr, "OT-NP: Using SHA-1\n");
-#endif
-
     start = current_time();
 
-    mpz_inits(r, gr, pk, pk0, NULL);
+    mpz_inits(r, c, gr, NULL);
 
-    msg = (char *) ot_malloc(sizeof(char) * maxlength);
-    if (msg == NULL)
-        ERROR;
     Cs = (mpz_t *) ot_malloc(sizeof(mpz_t) * (N - 1));
     if (Cs == NULL)
         ERROR;
     Crs = (mpz_t *) ot_malloc(sizeof(mpz_t) * (N - 1));
     if (Crs == NULL)
         ERROR;
-    pk0s = (mpz_t *) ot_malloc(sizeof(mpz_t) * num_ots);
-    if (pk0s == NULL)
-        ERROR;
-
-    for (int i = 0; i < num_ots; ++i) {
-        mpz_init(pk0s[i]);
+    for (int i = 0; i < N - 1; ++i) {
+        mpz_inits(Cs[i], Crs[i], NULL);
     }
-
-#ifdef AES_HW
-    AES_KEY key;
-    AES_set_encrypt_key((unsigned char *) "abcd", 128, &key);
-#endif
-
     // choose r \in_R Zq
-    random_element(r, &st->p);
+    random_scalar(r, &st->p);
     // compute g^r
-    mpz_powm(gr, st->p.g, r, st->p.p);
+    fbtable_powm(gr, &st->p.gtab, r, st->p.p);
 
-    // choose C_i's \in_R Zq
+    // choose C_i's \in_R <g>
     for (int i = 0; i < N - 1; ++i) {
-        mpz_inits(Cs[i], Crs[i], NULL);
-        random_element(Cs[i], &st->p);
+        random_scalar(c, &st->p);
+        fbtable_powm(Cs[i], &st->p.gtab, c, st->p.p);
+    }
+
+    slots = alloc_slots(nslots, st, N, maxlength,
+                        (size_t) NP_CHUNK * N * maxlength);
+    if (slots == NULL)
+        ERROR;
+    for (unsigned int i = 0; i < nslots; ++i) {
+        slots[i].r = (const mpz_t *) &r;
+        slots[i].Crs = Crs;
+        slots[i].msgs = msgs;
     }
 
     end = current_time();
@@ -94,7 +334,7 @@ ot_np_send(struct state *st, void *msgs, int maxlength, int num_ots, int N,
     // send g^r to receiver
     start = current_time();
     mpz_to_array(buf, gr, sizeof buf);
-    if (sendall(st->sockfd, buf, sizeof buf) == -1)
+    if (channel_send(&st->ch, buf, sizeof buf) == -1)
         ERROR;
     end = current_time();
     fprintf(stderr, "Send g^r to receiver: %f\n", end - start);
@@ -103,7 +343,7 @@ ot_np_send(struct state *st, void *msgs, int maxlength, int num_ots, int N,
     start = current_time();
     for (int i = 0; i < N - 1; ++i) {
         mpz_to_array(buf, Cs[i], sizeof buf);
-        if (sendall(st->sockfd, buf, sizeof buf) == -1)
+        if (channel_send(&st->ch, buf, sizeof buf) == -1)
             ERROR;
     }
     end = current_time();
@@ -117,62 +357,57 @@ ot_np_send(struct state *st, void *msgs, int maxlength, int num_ots, int N,
     end = current_time();
     fprintf(stderr, "Compute C_i^r: %f\n", end - start);
 
+    /*
+     * Chunk c of pk0s goes to slot c % nslots as soon as it arrives; the
+     * ciphertexts of chunk c - NP_WINDOW are sent once chunk c has been
+     * received, which frees the slot for chunk c + 1.
+     */
     start = current_time();
-    for (int j = 0; j < num_ots; ++j) {
-        // get pk0 from receiver
-        if (recvall(st->sockfd, buf, sizeof buf) == -1)
-            ERROR;
-        array_to_mpz(pk0s[j], buf, sizeof buf);
-    }
-    end = current_time();
-    fprintf(stderr, "Get pk0 from receiver: %f\n", end - start);
-
-    for (int j = 0; j < num_ots; ++j) {
-        void *ot = ot_msg_reader(msgs, j);
-        for (int i = 0; i < N; ++i) {
-            char *item;
-            ssize_t itemlength;
-
-            if (i == 0) {
-                // compute pk0^r
-                mpz_powm(pk0, pk0s[j], r, st->p.p);
-                mpz_to_array(buf, pk0, sizeof buf);
-                (void) mpz_invert(pk0, pk0, st->p.p);
-            } else {
-                mpz_mul(pk, pk0, Crs[i - 1]);
-                mpz_mod(pk, pk, st->p.p);
-                mpz_to_array(buf, pk, sizeof buf);
+    for (int c = 0; c < nchunks + NP_WINDOW; ++c) {
+        if (c < nchunks) {
+            struct np_slot *slot = &slots[c % nslots];
+
+            slot->j0 = c * NP_CHUNK;
+            slot->n = MIN(num_ots - slot->j0, NP_CHUNK);
+            slot->err = 0;
+            // get pk0s of the chunk from receiver
+            if (channel_recv(&st->ch, slot->pk0s,
+                             (long) slot->n * field_size) == -1) {
+                err = 1;
+                break;
+            }
+            completion_reset(&slot->done);
+            if (threadpool_add_job(st->pool, np_send_job, slot) == FAILURE) {
+                err = 1;
+                break;
+            }
+        }
+        if (c >= NP_WINDOW && c - NP_WINDOW < nchunks) {
+            struct np_slot *slot = &slots[(c - NP_WINDOW) % nslots];
+
+            completion_wait(&slot->done);
+            if (slot->err) {
+                (void) fprintf(stderr, "invalid pk0 from receiver\n");
+                err = 1;
+                break;
+            }
+            if (channel_send(&st->ch, slot->buf,
+                             (long) slot->n * N * maxlength) == -1
+                || channel_flush(&st->ch) == -1) {
+                err = 1;
+                break;
             }
-
-#ifdef AES_HW
-            if (AES_encrypt_message((unsigned char *) buf, sizeof buf,
-                                    (unsigned char *) msg, maxlength, &key))
-                ERROR;
-#endif
-#ifdef SHA
-            (void) memset(msg, '\0', maxlength);
-            sha1_hash(msg, maxlength, i, (unsigned char *) buf, sizeof buf);
-#endif            
-
-            ot_item_reader(ot, i, &item, &itemlength);
-            assert(itemlength <= maxlength);
-
-            xorarray((unsigned char *) msg, maxlength,
-                     (unsigned char *) item, itemlength);
-            if (sendall(st->sockfd, msg, maxlength) == -1)
-                ERROR;
         }
     }
+    threadpool_wait(st->pool);
+    end = current_time();
+    fprintf(stderr, "Compute and send ciphertexts (%u threads): %f\n",
+            threadpool_nthreads(st->pool), end - start);
 
  cleanup:
-    mpz_clears(r, gr, pk, pk0, NULL);
+    free_slots(slots, nslots);
+    mpz_clears(r, c, gr, NULL);
 
-    if (pk0s) {
-        for (int i = 0; i < num_ots; ++i) {
-            mpz_clear(pk0s[i]);
-        }
-        ot_free(pk0s);
-    }
     if (Crs) {
         for (int i = 0; i < N - 1; ++i)
             mpz_clear(Crs[i]);
@@ -183,37 +418,57 @@ ot_np_send(struct state *st, void *msgs, int maxlength, int num_ots, int N,
             mpz_clear(Cs[i]);
         ot_free(Cs);
     }
-    if (msg)
-        ot_free(msg);
 
     return err;
 }
 
+/*
+ * Receives the ciphertexts of the 'n' OTs starting at 'j0' and strips the
+ * pads already stored in 'out' from the chosen messages.
+ */
+static int
+recv_chunk(struct state *st, unsigned char *buf, const unsigned char *choices,
+           int j0, int n, int N, int maxlength, unsigned char *out)
+{
+    // get H xor M_i from sender
+    if (channel_recv(&st->ch, buf, (long) n * N * maxlength) == -1)
+        return FAILURE;
+    for (int k = 0; k < n; ++k) {
+        const int j = j0 + k;
+
+        xorarray(out + (long) j * maxlength, maxlength,
+                 buf + ((long) k * N + choices[j]) * maxlength, maxlength);
+    }
+    return SUCCESS;
+}
+
 int
-ot_np_recv(struct state *st, void *choices, int nchoices, int maxlength, int N,
-           void *out,
-           ot_choice_reader ot_choice_reader, ot_msg_writer ot_msg_writer)
+ot_np_recv(struct state *st, const unsigned char *choices, int nchoices,
+           int maxlength, int N, unsigned char *out)
 {
-    mpz_t gr, pk0, pks;
-    mpz_t *Cs = NULL, *ks = NULL;
-    char buf[field_size], *from = NULL, *msg = NULL;
-    int err = 0;
+    mpz_t gr;
+    mpz_t *Cs = NULL;
+    char buf[field_size];
+    unsigned char *msgs = NULL;
+    struct np_slot *slots = NULL;
+    const unsigned int nslots = 2 * MAX(threadpool_nthreads(st->pool), 1);
+    const int nchunks = (nchoices + NP_CHUNK - 1) / NP_CHUNK;
+    int err = 0, recvd = 0;
     double start, end;
 
-#ifdef AES_HW
-    fprintf(stderr, "OT-NP: Using AESNI\n");
-#endif
-#ifdef SHA
-    fprintf(stderr, "OT-NP: Using SHA-1\n");
-#endif
+    /* a choice of N or more would index past 'Cs' and the ciphertexts */
+    for (int j = 0; j < nchoices; ++j) {
+        if (choices[j] >= N) {
+            (void) fprintf(stderr, "invalid choice %d for OT %d\n",
+                           choices[j], j);
+            return 1;
+        }
+    }
 
-    mpz_inits(gr, pk0, pks, NULL);
+    mpz_init(gr);
 
-    msg = (char *) ot_malloc(sizeof(char) * maxlength);
-    if (msg == NULL)
-        ERROR;
-    from = (char *) ot_malloc(sizeof(char) * maxlength);
-    if (from == NULL)
+    msgs = (unsigned char *) ot_malloc((long) NP_CHUNK * N * maxlength);
+    if (msgs == NULL)
         ERROR;
     Cs = (mpz_t *) ot_malloc(sizeof(mpz_t) * (N - 1));
     if (Cs == NULL)
@@ -221,21 +476,19 @@ ot_np_recv(struct state *st, void *choices, int nchoices, int maxlength, int N,
     for (int i = 0; i < N - 1; ++i) {
         mpz_init(Cs[i]);
     }
-    ks = (mpz_t *) ot_malloc(sizeof(mpz_t) * nchoices);
-    if (ks == NULL)
+    slots = alloc_slots(nslots, st, N, maxlength, 0);
+    if (slots == NULL)
         ERROR;
-    for (int j = 0; j < nchoices; ++j) {
-        mpz_init(ks[j]);
+    for (unsigned int i = 0; i < nslots; ++i) {
+        slots[i].gr = (const mpz_t *) &gr;
+        slots[i].Cs = Cs;
+        slots[i].choices = choices;
+        slots[i].pads = out;
     }
 
-#ifdef AES_HW
-    AES_KEY key;
-    AES_set_encrypt_key((unsigned char *) "abcd", 128, &key);
-#endif
-
     // get g^r from sender
     start = current_time();
-    if (recvall(st->sockfd, buf, sizeof buf) == -1)
+    if (channel_recv(&st->ch, buf, sizeof buf) == -1)
         ERROR;
     array_to_mpz(gr, buf, sizeof buf);
     end = current_time();
@@ -244,89 +497,69 @@ ot_np_recv(struct state *st, void *choices, int nchoices, int maxlength, int N,
     // get Cs from sender
     start = current_time();
     for (int i = 0; i < N - 1; ++i) {
-        if (recvall(st->sockfd, buf, sizeof buf) == -1)
+        if (channel_recv(&st->ch, buf, sizeof buf) == -1)
             ERROR;
         array_to_mpz(Cs[i], buf, sizeof buf);
     }
     end = current_time();
     fprintf(stderr, "Get Cs from sender: %f\n", end - start);
 
+    /*
+     * Workers compute pk0 and the pad of the chosen message for each OT.  The
+     * pk0s are sent in order as their chunks finish, and the ciphertexts of
+     * chunk c - NP_WINDOW are taken in right after chunk c has gone out.
+     */
     start = current_time();
-    for (int j = 0; j < nchoices; ++j) {
-        long choice;
-
-        choice = ot_choice_reader(choices, j);
-        // choose random k
-        mpz_urandomb(ks[j], st->p.rnd, sizeof buf * 8);
-        mpz_mod(ks[j], ks[j], st->p.q);
-        // compute pks = g^k
-        mpz_powm(pks, st->p.g, ks[j], st->p.p);
-        // compute pk0 = C_1 / g^k regardless of whether our choice is 0 or 1 to
-        // avoid a potential side-channel attack
-        (void) mpz_invert(pk0, pks, st->p.p);
-        mpz_mul(pk0, pk0, Cs[0]);
-        mpz_mod(pk0, pk0, st->p.p);
-        mpz_set(pk0, choice == 0 ? pks : pk0);
-        mpz_to_array(buf, pk0, sizeof buf);
-        // send pk0 to sender
-        if (sendall(st->sockfd, buf, sizeof buf) == -1)
-            ERROR;
-    }
-    end = current_time();
-    fprintf(stderr, "Send pk0s to sender: %f\n", end - start);
-
-    for (int j = 0; j < nchoices; ++j) {
-        long choice;
-
-        choice = ot_choice_reader(choices, j);
-
-        // compute decryption key (g^r)^k
-        mpz_powm(ks[j], gr, ks[j], st->p.p);
-
-
-        for (int i = 0; i < N; ++i) {
-            mpz_to_array(buf, ks[j], sizeof buf);
-            // get H xor M0 from sender
-            if (recvall(st->sockfd, msg, maxlength) == -1)
+    for (int c = 0, sent = 0; sent < nchunks; ++c) {
+        if (c >= (int) nslots || c >= nchunks) {
+            struct np_slot *slot = &slots[sent % nslots];
+
+            completion_wait(&slot->done);
+            if (channel_send(&st->ch, slot->pk0s,
+                             (long) slot->n * field_size) == -1
+                || channel_flush(&st->ch) == -1)
                 ERROR;
+            if (sent++ >= NP_WINDOW) {
+                if (recv_chunk(st, msgs, choices, recvd * NP_CHUNK,
+                               MIN(nchoices - recvd * NP_CHUNK, NP_CHUNK),
+                               N, maxlength, out) == FAILURE)
+                    ERROR;
+                ++recvd;
+            }
+        }
+        if (c < nchunks) {
+            struct np_slot *slot = &slots[c % nslots];
 
-#ifdef AES_HW
-            if (AES_encrypt_message((unsigned char *) buf, sizeof buf,
-                                    (unsigned char *) from, maxlength, &key))
+            slot->j0 = c * NP_CHUNK;
+            slot->n = MIN(nchoices - slot->j0, NP_CHUNK);
+            completion_reset(&slot->done);
+            if (threadpool_add_job(st->pool, np_recv_job, slot) == FAILURE)
                 ERROR;
-#endif
-#ifdef SHA
-            (void) memset(from, '\0', maxlength);
-            sha1_hash(from, maxlength, i, (unsigned char *) buf, sizeof buf);
-#endif
-
-            xorarray((unsigned char *) msg, maxlength,
-                     (unsigned char *) from, maxlength);
-
-            if (i == choice) {
-                ot_msg_writer(out, j, msg, maxlength);
-            }
         }
     }
+    for (; recvd < nchunks; ++recvd) {
+        if (recv_chunk(st, msgs, choices, recvd * NP_CHUNK,
+                       MIN(nchoices - recvd * NP_CHUNK, NP_CHUNK),
+                       N, maxlength, out) == FAILURE)
+            ERROR;
+    }
+    end = current_time();
+    fprintf(stderr, "Exchange pk0s and ciphertexts (%u threads): %f\n",
+            threadpool_nthreads(st->pool), end - start);
 
  cleanup:
-    mpz_clears(gr, pk0, pks, NULL);
+    /* no job may touch the slots once they are freed */
+    threadpool_wait(st->pool);
+    free_slots(slots, nslots);
+    mpz_clear(gr);
 
-    if (ks) {
-        for (int j = 0; j < nchoices; ++j) {
-            mpz_clear(ks[j]);
-        }
-        ot_free(ks);
-    }
     if (Cs) {
         for (int i = 0; i < N - 1; ++i)
             mpz_clear(Cs[i]);
         ot_free(Cs);
     }
-    if (msg)
-        ot_free(msg);
-    if (from)
-        ot_free(from);
+    if (msgs)
+        ot_free(msgs);
 
     return err;
 }
@@ -4,12 +4,20 @@
 #include "ot.h"
 #include "state.h"
 
+/*
+ * Runs the sender side of 'num_ots' 1-out-of-N OTs.  'msgs' holds
+ * num_ots * N messages of 'maxlength' bytes each (see ot.h).
+ */
 int
-ot_np_send(struct state *st, void *msgs, int msglength, int num_ots, int N,
-           ot_msg_reader ot_msg_reader, ot_item_reader ot_item_reader);
+ot_np_send(struct state *st, const unsigned char *msgs, int maxlength,
+           int num_ots, int N);
+/*
+ * Runs the receiver side of 'nchoices' 1-out-of-N OTs.  'choices' holds one
+ * byte per OT and the chosen messages are written to 'out', which must hold
+ * nchoices * maxlength bytes.
+ */
 int
-ot_np_recv(struct state *st, void *choices, int nchoices, int maxlength, int N,
-           void *out,
-           ot_choice_reader ot_choice_reader, ot_msg_writer ot_msg_writer);
+ot_np_recv(struct state *st, const unsigned char *choices, int nchoices,
+           int maxlength, int N, unsigned char *out);
 
 #endif
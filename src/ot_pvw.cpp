@@ -2,6 +2,11 @@
  * Implementation of maliciously secure OT as detailed by Peikert et al. [1].
  * In particular, we implement the DDH protocol detailed in the paper.
  *
+ * Messages are not encoded as group elements: each branch is encrypted with a
+ * pad derived from the DDH key, KEM-style, so messages can have any length.
+ * All OTs of a batch run in two flights, one carrying the receiver's keys and
+ * one carrying the sender's ciphertexts.
+ *
  * Author: Alex J. Malozemoff <amaloz@cs.umd.edu>
  *
  * [1] "A Framework for Efficient and Composable Oblivious Transfer."
@@ -9,502 +14,244 @@
  */
 #include "ot_pvw.h"
 
+#include "crypto.h"
 #include "gmputils.h"
 #include "net.h"
+#include "pvw_crs.h"
 #include "state.h"
 #include "utils.h"
 
-#include <fcntl.h>
-
-// static const char *tag = "OT-PVW";
-
-enum crs_type {
-    EXT,
-    DEC
-};
-
-struct ddh_pk {
-    mpz_t g;
-    mpz_t h;
-    mpz_t gp;
-    mpz_t hp;
-};
-
-struct ddh_sk {
-    mpz_t x;
-};
-
-struct ddh_ctxt {
-    mpz_t u;
-    mpz_t v;
-};
-
-struct dm_ddh_crs {
-    mpz_t g0;
-    mpz_t h0;
-    mpz_t g1;
-    mpz_t h1;
-};
-
-struct dm_ddh_pk {
-    mpz_t g;
-    mpz_t h;
-};
-
-static int
-send_dm_ddh_pk(struct dm_ddh_pk *pk, const struct state *st)
-{
-    char g[FIELD_SIZE], h[FIELD_SIZE];
-
-    mpz_to_array(g, pk->g, sizeof g);
-    mpz_to_array(h, pk->h, sizeof h);
-    if (pysend(st->sockfd, g, sizeof g, 0) == -1) {
-        return FAILURE;
-    }
-    if (pysend(st->sockfd, h, sizeof h, 0) == -1) {
-        return FAILURE;
-    }
-    return SUCCESS;
-}
-
-static int
-receive_dm_ddh_pk(struct dm_ddh_pk *pk, const struct state *st)
-{
-    char g[FIELD_SIZE], h[FIELD_SIZE];
-
-    if (pyrecv(st->sockfd, g, sizeof g, 0) == -1)
-        return FAILURE;
-    if (pyrecv(st->sockfd, h, sizeof h, 0) == -1)
-        return FAILURE;
-    array_to_mpz(pk->g, g, sizeof g);
-    array_to_mpz(pk->h, h, sizeof h);
-    return SUCCESS;
-}
-
-static int
-send_ddh_ctxt(struct ddh_ctxt *ctxt, const struct state *st)
-{
-    char u[FIELD_SIZE], v[FIELD_SIZE];
-
-    mpz_to_array(u, ctxt->u, sizeof u);
-    mpz_to_array(v, ctxt->v, sizeof v);
-    if (pysend(st->sockfd, u, sizeof u, 0) == -1) {
-        return FAILURE;
-    }
-    if (pysend(st->sockfd, v, sizeof v, 0) == -1) {
-        return FAILURE;
-    }
-    return SUCCESS;
-}
-
-static int
-receive_ddh_ctxt(struct ddh_ctxt *ctxt, const struct state *st)
-{
-    char u[FIELD_SIZE], v[FIELD_SIZE];
-
-    if (pyrecv(st->sockfd, u, sizeof u, 0) == -1)
-        return FAILURE;
-    if (pyrecv(st->sockfd, v, sizeof v, 0) == -1)
-        return FAILURE;
-    array_to_mpz(ctxt->u, u, sizeof u);
-    array_to_mpz(ctxt->v, v, sizeof v);
-    return SUCCESS;
-}
-
-// FIXME: how should we deal with the CRS?  Run it once and hardcode the
-// results?
-
-static void
-dm_ddh_setup_messy(struct dm_ddh_crs *crs, struct params *p)
-{
-    mpz_t x0, x1;
-    int file;
-    unsigned long seed;
-
-    mpz_inits(x0, x1, NULL);
-
-    /* fix seed of random number generator */
-    gmp_randseed_ui(p->rnd, 0UL);
-
-    find_generator(crs->g0, p);
-    find_generator(crs->g1, p);
-    do {
-        random_element(x0, p);
-        random_element(x1, p);
-    } while (mpz_cmp(x0, x1) == 0);
-
-    mpz_powm(crs->h0, crs->g0, x0, p->p);
-    mpz_powm(crs->h1, crs->g1, x1, p->p);
-
-    mpz_clears(x0, x1, NULL);
-
-    /* re-seed random number generator */
-    if ((file = open("/dev/urandom", O_RDONLY)) == -1) {
-        (void) fprintf(stderr, "Error opening /dev/urandom\n");
-    } else {
-        if (read(file, &seed, sizeof seed) == -1) {
-            (void) fprintf(stderr, "Error reading from /dev/urandom\n");
-            (void) close(file);
-        }
-    }
-    gmp_randseed_ui(p->rnd, seed);
-    (void) close(file);
-}
-
-static void
-dm_ddh_setup_dec(struct dm_ddh_crs *crs, struct params *p)
-{
-    mpz_t x, y;
-    int file;
-    unsigned long seed;
-
-    mpz_inits(x, y, NULL);
-
-    /* fix seed of random number generator */
-    gmp_randseed_ui(p->rnd, 0UL);
-
-    find_generator(crs->g0, p);
-    random_element(y, p);
-    mpz_powm(crs->g1, crs->g0, y, p->p);
-    mpz_powm(crs->h0, crs->g0, x, p->p);
-    mpz_powm(crs->h1, crs->g1, x, p->p);
-
-    mpz_clears(x, y, NULL);
-
-    /* re-seed random number generator */
-    if ((file = open("/dev/urandom", O_RDONLY)) == -1) {
-        (void) fprintf(stderr, "Error opening /dev/urandom\n");
-    } else {
-        if (read(file, &seed, sizeof seed) == -1) {
-            (void) fprintf(stderr, "Error reading from /dev/urandom\n");
-            (void) close(file);
-        }
-    }
-    gmp_randseed_ui(p->rnd, seed);
-    (void) close(file);
-}
-
-static void
-dm_ddh_crs_setup(struct dm_ddh_crs *crs, enum crs_type mode, struct params *p)
-{
-    mpz_inits(crs->g0, crs->h0, crs->g1, crs->h1, NULL);
-    switch (mode) {
-    case EXT:
-        dm_ddh_setup_messy(crs, p);
-        break;
-    case DEC:
-        dm_ddh_setup_dec(crs, p);
-        break;
-    }
-}
+#include <string.h>
 
-static void
-dm_ddh_crs_cleanup(struct dm_ddh_crs *crs)
-{
-    mpz_clears(crs->g0, crs->h0, crs->g1, crs->h1, NULL);
-}
+#include <openssl/evp.h>
+#include <openssl/sha.h>
+#include "aes.h"
 
-static void
-dm_ddh_pk_setup(struct dm_ddh_pk *pk)
-{
-    mpz_inits(pk->g, pk->h, NULL);
-}
-
-static void
-dm_ddh_pk_cleanup(struct dm_ddh_pk *pk)
-{
-    mpz_clears(pk->g, pk->h, NULL);
-}
-
-static void
-ddh_sk_setup(struct ddh_sk *sk)
-{
-    mpz_init(sk->x);
-}
-
-static void
-ddh_sk_cleanup(struct ddh_sk *sk)
-{
-    mpz_clear(sk->x);
-}
-
-static void
-ddh_ctxt_setup(struct ddh_ctxt *c)
-{
-    mpz_inits(c->u, c->v, NULL);
-}
+#define ERROR { err = 1; goto cleanup; }
 
+/*
+ * Derives a 'outlen' byte pad for branch 'i' from the randomized element 'u'
+ * and the DDH key 'v'.  As in ot_np.cpp, the elements are hashed to one block
+ * with SHA-256 and expanded with the fixed-key hash.
+ */
 static void
-ddh_ctxt_cleanup(struct ddh_ctxt *c)
+hash_key(unsigned char *out, size_t outlen, int i, const char *u,
+         const mpz_t v, const AES_KEY *key)
 {
-    mpz_clears(c->u, c->v, NULL);
+    unsigned char digest[SHA256_DIGEST_LENGTH];
+    char buf[field_size];
+    EVP_MD_CTX *ctx;
+    block seed;
+
+    mpz_to_array(buf, v, sizeof buf);
+    ctx = EVP_MD_CTX_new();
+    (void) EVP_DigestInit_ex(ctx, EVP_sha256(), NULL);
+    (void) EVP_DigestUpdate(ctx, u, field_size);
+    (void) EVP_DigestUpdate(ctx, buf, sizeof buf);
+    (void) EVP_DigestFinal_ex(ctx, digest, NULL);
+    EVP_MD_CTX_free(ctx);
+    seed = _mm_loadu_si128((__m128i *) digest);
+    AES_crhash_messages(&seed, 1, 1, i, out, outlen, key);
 }
 
+/*
+ * Encrypts 'msg' under the dual-mode key (g_b, h_b, gp, hp): picks s, t and
+ * writes u = g_b^s h_b^t followed by the message padded with the key
+ * v = gp^s hp^t.
+ */
 static void
-randomize(mpz_t u, mpz_t v, const mpz_t g, const mpz_t h, const mpz_t gp,
-          const mpz_t hp, struct params *p)
+dm_ddh_enc(unsigned char *out, const struct pvw_crs *crs, int branch,
+           const mpz_t gp, const mpz_t hp, const unsigned char *msg,
+           int maxlength, mpz_t u, mpz_t v, scalar s, scalar t,
+           struct state *st)
 {
-    mpz_t s, t, tmp;
+    struct params *p = &st->p;
 
-    mpz_inits(s, t, tmp, NULL);
+    random_scalar(s, p);
+    random_scalar(t, p);
 
-    random_element(s, p);
-    random_element(t, p);
-
-    /* compute g^s h^t */
-    mpz_powm(tmp, g, s, p->p);
-    mpz_powm(u, h, t, p->p);
-    mpz_mul(u, u, tmp);
+    /* compute g^s h^t from the fixed-base tables */
+    fbtable_powm(u, branch ? &crs->g1tab : &crs->g0tab, s, p->p);
+    fbtable_powm(v, branch ? &crs->h1tab : &crs->h0tab, t, p->p);
+    mpz_mul(u, u, v);
     mpz_mod(u, u, p->p);
+    mpz_to_array((char *) out, u, field_size);
 
     /* compute gp^s hp^t */
-    mpz_powm(tmp, gp, s, p->p);
-    mpz_powm(v, hp, t, p->p);
-    mpz_mul(v, v, tmp);
-    mpz_mod(v, v, p->p);
-
-    mpz_clears(s, t, tmp, NULL);
-}
-
-static void
-ddh_enc(struct ddh_ctxt *c, const struct ddh_pk *pk, const char *msg,
-        size_t msglen, struct params *p)
-{
-    mpz_t m;
-
-    mpz_init(m);
-
-    encode(m, msg, msglen, p);
-    randomize(c->u, c->v, pk->g, pk->h, pk->gp, pk->hp, p);
-    mpz_mul(c->v, c->v, m);
-    mpz_mod(c->v, c->v, p->p);
-
-    mpz_clear(m);
-}
-
-static char *
-ddh_dec(const struct ddh_sk *sk, const struct ddh_ctxt *c,
-        const struct params *p)
-{
-    mpz_t tmp;
-    char *out;
-
-    mpz_init(tmp);
-
-    mpz_powm(tmp, c->u, sk->x, p->p);
-    (void) mpz_invert(tmp, tmp, p->p);
-    mpz_mul(tmp, tmp, c->v);
-    out = decode(tmp, p);
-
-    mpz_clear(tmp);
-
-    return out;
-}
-
-static void
-dm_ddh_keygen(struct dm_ddh_pk *pk, struct ddh_sk *sk, int sigma, 
-              const struct dm_ddh_crs *crs, struct params *p)
-{
-    random_element(sk->x, p);
-    mpz_powm(pk->g, sigma ? crs->g1 : crs->g0, sk->x, p->p);
-    mpz_powm(pk->h, sigma ? crs->h1 : crs->h0, sk->x, p->p);
-}
-
-static void
-dm_ddh_enc(struct ddh_ctxt *ctxt, const struct dm_ddh_crs *crs,
-           struct dm_ddh_pk *pk, int branch, const char *msg,
-           size_t msglen, struct params *p)
-{
-    struct ddh_pk ddh_pk;
-
-    mpz_init_set(ddh_pk.g, branch ? crs->g1 : crs->g0);
-    mpz_init_set(ddh_pk.h, branch ? crs->h1 : crs->h0);
-    mpz_init_set(ddh_pk.gp, pk->g);
-    mpz_init_set(ddh_pk.hp, pk->h);
+    mpz_powm2(v, gp, s, hp, t, p->p);
 
-    ddh_enc(ctxt, &ddh_pk, msg, msglen, p);
+    hash_key(out + field_size, maxlength, branch, (char *) out, v,
+             &st->aeskey);
+    xorarray(out + field_size, maxlength, msg, maxlength);
 }
 
-static char *
-dm_ddh_dec(struct ddh_sk *sk, struct ddh_ctxt *ctxt,
-           const struct params *p)
+int
+ot_pvw_send(struct state *st, const unsigned char *msgs, int maxlength,
+            int num_ots, int N)
 {
-    return ddh_dec(sk, ctxt, p);
-}
-
-PyObject *
-ot_pvw_send(PyObject *self, PyObject *args)
-{
-    PyObject *py_state, *py_msgs;
-    unsigned int msglength;
-    struct dm_ddh_crs crs;
-    struct dm_ddh_pk pk;
-    struct ddh_ctxt ctxt;
-    struct state *st;
-    long N, num_ots;
+    const struct pvw_crs *crs = &st->pvw;
+    const long ctlen = 2 * (field_size + maxlength);
+    char *pks = NULL;
+    unsigned char *cts = NULL;
+    mpz_t gp, hp, u, v;
+    scalar s, t;
+    int err = 0;
     double start, end;
 
-    if (!PyArg_ParseTuple(args, "OOI", &py_state, &py_msgs, &msglength))
-        return NULL;
-
-    st = (struct state *) PyCapsule_GetPointer(py_state, NULL);
-    if (st == NULL)
-        return NULL;
+    assert(N == 2);
 
-    if ((num_ots = PySequence_Length(py_msgs)) == -1)
-        return NULL;
-
-    if ((N = PySequence_Length(PySequence_GetItem(py_msgs, 0))) == -1)
-        return NULL;
-
-    if (N != 2) {
-        PyErr_SetString(PyExc_RuntimeError, "N must be 2");
-        return NULL;
-    }
+    mpz_inits(gp, hp, u, v, s, t, NULL);
 
     start = current_time();
-    dm_ddh_crs_setup(&crs, EXT, &st->p);
+    if (pvw_crs_ready(&st->pvw, &st->p) == FAILURE)
+        ERROR;
+    pks = (char *) ot_malloc((long) num_ots * 2 * field_size);
+    if (pks == NULL)
+        ERROR;
+    cts = (unsigned char *) ot_malloc(num_ots * ctlen);
+    if (cts == NULL)
+        ERROR;
     end = current_time();
     fprintf(stderr, "CRS setup: %f\n", end - start);
 
+    // get all public keys from receiver
     start = current_time();
-    dm_ddh_pk_setup(&pk);
-    ddh_ctxt_setup(&ctxt);
+    if (channel_recv(&st->ch, pks, (long) num_ots * 2 * field_size) == -1)
+        ERROR;
+    end = current_time();
+    fprintf(stderr, "Get public keys from receiver: %f\n", end - start);
 
+    start = current_time();
     for (int j = 0; j < num_ots; ++j) {
-        PyObject *py_input;
-        // double start, end;
-
-        py_input = PySequence_GetItem(py_msgs, j);
-
-        // start = current_time();
-        receive_dm_ddh_pk(&pk, st);
-        // end = current_time();
-        // fprintf(stderr, "receive dm ddh pk: %f\n", end - start);
-
+        array_to_mpz(gp, pks + (long) j * 2 * field_size, field_size);
+        array_to_mpz(hp, pks + ((long) j * 2 + 1) * field_size, field_size);
+        if (!in_subgroup(gp, u, &st->p) || !in_subgroup(hp, u, &st->p)) {
+            (void) fprintf(stderr, "invalid public key from receiver\n");
+            ERROR;
+        }
         for (int b = 0; b <= 1; ++b) {
-            char *m;
-            Py_ssize_t mlen;
-
-            (void) PyBytes_AsStringAndSize(PySequence_GetItem(py_input, b),
-                                           &m, &mlen);
-            fprintf(stderr, "%s\n", m);
-            fprintf(stderr, "%ld %u\n", mlen, msglength);
-            assert(mlen <= msglength);
-            // start = current_time();
-            dm_ddh_enc(&ctxt, &crs, &pk, b, m, mlen, &st->p);
-            // end = current_time();
-            // fprintf(stderr, "encrypt dm ddh: %f\n", end - start);
-
-            // start = current_time();
-            send_ddh_ctxt(&ctxt, st);
-            // end = current_time();
-            // fprintf(stderr, "send ddh ctxt: %f\n", end - start);
+            dm_ddh_enc(cts + j * ctlen + b * (field_size + maxlength), crs, b,
+                       gp, hp, msgs + ((long) j * 2 + b) * maxlength,
+                       maxlength, u, v, s, t, st);
         }
     }
     end = current_time();
-    fprintf(stderr, "OT: %f\n", end - start);
+    fprintf(stderr, "Compute ciphertexts: %f\n", end - start);
 
-    ddh_ctxt_cleanup(&ctxt);
-    dm_ddh_pk_cleanup(&pk);
-    dm_ddh_crs_cleanup(&crs);
+    // send all ciphertexts in one flight
+    start = current_time();
+    if (channel_send(&st->ch, cts, num_ots * ctlen) == -1
+        || channel_flush(&st->ch) == -1)
+        ERROR;
+    end = current_time();
+    fprintf(stderr, "Send ciphertexts: %f\n", end - start);
 
-    Py_RETURN_NONE;
+ cleanup:
+    mpz_clears(gp, hp, u, v, s, t, NULL);
+    if (pks)
+        ot_free(pks);
+    if (cts)
+        ot_free(cts);
+
+    return err;
 }
 
-PyObject *
-ot_pvw_receive(PyObject *self, PyObject *args)
+int
+ot_pvw_recv(struct state *st, const unsigned char *choices, int nchoices,
+            int maxlength, int N, unsigned char *out)
 {
-    PyObject *py_state, *py_choices, *py_return = NULL;
-    struct dm_ddh_crs crs;
-    struct dm_ddh_pk pk;
-    struct ddh_sk sk;
-    struct ddh_ctxt ctxt;
-    struct state *st;
-    int num_ots;
-    unsigned int N, msglength, err = 0;
+    const struct pvw_crs *crs = &st->pvw;
+    const long ctlen = 2 * (field_size + maxlength);
+    char *pks = NULL;
+    unsigned char *cts = NULL;
+    mpz_t *sks = NULL;
+    mpz_t u, v;
+    int err = 0;
     double start, end;
 
-    if (!PyArg_ParseTuple(args, "OOII", &py_state, &py_choices, &N, &msglength))
-        return NULL;
+    assert(N == 2);
 
-    st = (struct state *) PyCapsule_GetPointer(py_state, NULL);
-    if (st == NULL)
-        return NULL;
-
-    if (N != 2) {
-        PyErr_SetString(PyExc_RuntimeError, "N must be 2");
-        return NULL;
+    /* a choice byte other than 0 or 1 would select a ciphertext past 'cts' */
+    for (int j = 0; j < nchoices; ++j) {
+        if (choices[j] > 1) {
+            (void) fprintf(stderr, "invalid choice %d for OT %d\n",
+                           choices[j], j);
+            return 1;
+        }
     }
 
-    if ((num_ots = PySequence_Length(py_choices)) == -1)
-        return NULL;
+    mpz_inits(u, v, NULL);
 
     start = current_time();
-    // FIXME: choice of mode should not be hardcoded
-    dm_ddh_crs_setup(&crs, EXT, &st->p);
+    if (pvw_crs_ready(&st->pvw, &st->p) == FAILURE)
+        ERROR;
+    pks = (char *) ot_malloc((long) nchoices * 2 * field_size);
+    if (pks == NULL)
+        ERROR;
+    cts = (unsigned char *) ot_malloc(nchoices * ctlen);
+    if (cts == NULL)
+        ERROR;
+    sks = (mpz_t *) ot_malloc(sizeof(mpz_t) * nchoices);
+    if (sks == NULL)
+        ERROR;
+    for (int j = 0; j < nchoices; ++j) {
+        mpz_init(sks[j]);
+    }
     end = current_time();
     fprintf(stderr, "CRS setup: %f\n", end - start);
 
-    dm_ddh_pk_setup(&pk);
-    ddh_sk_setup(&sk);
-    ddh_ctxt_setup(&ctxt);
+    // key generation: pk = (g_choice^r, h_choice^r), sk = r
+    start = current_time();
+    for (int j = 0; j < nchoices; ++j) {
+        const int choice = choices[j];
+
+        random_scalar(sks[j], &st->p);
+        fbtable_powm(u, choice ? &crs->g1tab : &crs->g0tab, sks[j], st->p.p);
+        fbtable_powm(v, choice ? &crs->h1tab : &crs->h0tab, sks[j], st->p.p);
+        mpz_to_array(pks + (long) j * 2 * field_size, u, field_size);
+        mpz_to_array(pks + ((long) j * 2 + 1) * field_size, v, field_size);
+    }
+    end = current_time();
+    fprintf(stderr, "Key generation: %f\n", end - start);
 
-    py_return = PyTuple_New(num_ots);
+    // send all public keys in one flight
+    start = current_time();
+    if (channel_send(&st->ch, pks, (long) nchoices * 2 * field_size) == -1
+        || channel_flush(&st->ch) == -1)
+        ERROR;
+    if (channel_recv(&st->ch, cts, nchoices * ctlen) == -1)
+        ERROR;
+    end = current_time();
+    fprintf(stderr, "Exchange keys and ciphertexts: %f\n", end - start);
 
     start = current_time();
-    for (int j = 0; j < num_ots; ++j) {
-        unsigned int choice;
-        // double start, end;
-
-        choice = PyLong_AsLong(PySequence_GetItem(py_choices, j));
-
-        // start = current_time();
-        dm_ddh_keygen(&pk, &sk, choice, &crs, &st->p);
-        // end = current_time();
-        // fprintf(stderr, "ddh keygen: %f\n", end - start);
-
-        // start = current_time();
-        send_dm_ddh_pk(&pk, st);
-        // end = current_time();
-        // fprintf(stderr, "send dm ddh pk: %f\n", end - start);
-
-        for (unsigned int b = 0; b <= 1; ++b) {
-            char *msg;
-            PyObject *str;
-
-            // start = current_time();
-            receive_ddh_ctxt(&ctxt, st);
-            // end = current_time();
-            // fprintf(stderr, "receive dm ddh ctxt: %f\n", end - start);
-
-            // start = current_time();
-            msg = dm_ddh_dec(&sk, &ctxt, &st->p);
-            // end = current_time();
-            // fprintf(stderr, "decrypt ddh ctxt: %f\n", end - start);
-
-            str = PyString_FromStringAndSize(msg, msglength);
-            free(msg);
-            if (str == NULL) {
-                err = 1;
-                goto cleanup;
-            }
-            if (choice == b) {
-                PyTuple_SetItem(py_return, j, str);
-            }
-        }
+    for (int j = 0; j < nchoices; ++j) {
+        const int choice = choices[j];
+        const unsigned char *ct = cts + j * ctlen
+            + choice * (field_size + maxlength);
+
+        // compute the DDH key u^r
+        array_to_mpz(u, (const char *) ct, field_size);
+        mpz_powm(v, u, sks[j], st->p.p);
+        hash_key(out + (long) j * maxlength, maxlength, choice,
+                 (const char *) ct, v, &st->aeskey);
+        xorarray(out + (long) j * maxlength, maxlength, ct + field_size,
+                 maxlength);
     }
     end = current_time();
-    fprintf(stderr, "OT: %f\n", end - start);
+    fprintf(stderr, "Decrypt: %f\n", end - start);
 
  cleanup:
-    ddh_ctxt_cleanup(&ctxt);
-    ddh_sk_cleanup(&sk);
-    dm_ddh_pk_cleanup(&pk);
-    dm_ddh_crs_cleanup(&crs);
-
-    if (err)
-        return NULL;
-    else
-        return py_return;
+    mpz_clears(u, v, NULL);
+    if (sks) {
+        for (int j = 0; j < nchoices; ++j)
+            mpz_clear(sks[j]);
+        ot_free(sks);
+    }
+    if (pks)
+        ot_free(pks);
+    if (cts)
+        ot_free(cts);
+
+    return err;
 }
@@ -1,12 +1,25 @@
 #ifndef __OTLIB_OT_PVW_H__
 #define __OTLIB_OT_PVW_H__
 
-#include <Python.h>
+#include "ot.h"
+#include "state.h"
 
-PyObject *
-ot_pvw_send(PyObject *self, PyObject *args);
+/*
+ * Runs the sender side of 'num_ots' 1-out-of-2 OTs.  'msgs' holds
+ * num_ots * 2 messages of 'maxlength' bytes each (see ot.h).  'N' must be 2.
+ */
+int
+ot_pvw_send(struct state *st, const unsigned char *msgs, int maxlength,
+            int num_ots, int N);
 
-PyObject *
-ot_pvw_receive(PyObject *self, PyObject *args);
+/*
+ * Runs the receiver side of 'nchoices' 1-out-of-2 OTs.  'choices' holds one
+ * byte, 0 or 1, per OT and the chosen messages are written to 'out', which
+ * must hold nchoices * maxlength bytes.  'N' must be 2.  Fails on any other
+ * choice value.
+ */
+int
+ot_pvw_recv(struct state *st, const unsigned char *choices, int nchoices,
+            int maxlength, int N, unsigned char *out);
 
 #endif
@@ -0,0 +1,134 @@
+#include "otext.h"
+#include "ot.h"
+
+#include "aes.h"
+#include "crypto.h"
+#include "net.h"
+#include "threadpool.h"
+#include "utils.h"
+
+#include <string.h>
+
+struct expand_job {
+    const unsigned char *seed;
+    unsigned char *out;
+    size_t len;
+};
+
+static void
+expand_job(void *arg)
+{
+    struct expand_job *job = (struct expand_job *) arg;
+
+    AES_ctr_expand(job->seed, job->out, job->len);
+}
+
+/*
+ * Expands seed i to 'len' bytes at out + i * len for each i, on the pool.
+ */
+static int
+expand_seeds(struct state *st, const unsigned char *seeds,
+             size_t seedstride, unsigned int nseeds, unsigned char *out,
+             size_t len)
+{
+    struct expand_job *jobs;
+    int err = 0;
+
+    jobs = (struct expand_job *) ot_malloc(sizeof(struct expand_job) * nseeds);
+    if (jobs == NULL)
+        return FAILURE;
+    for (unsigned int i = 0; i < nseeds; ++i) {
+        jobs[i].seed = seeds + i * seedstride;
+        jobs[i].out = out + i * len;
+        jobs[i].len = len;
+        if (threadpool_add_job(st->pool, expand_job, &jobs[i]) == FAILURE) {
+            err = 1;
+            break;
+        }
+    }
+    threadpool_wait(st->pool);
+    ot_free(jobs);
+    return err;
+}
+
+int
+otext_expand_send(struct state *st, const unsigned char *seeds,
+                  const unsigned char *s, unsigned int ncols, long nrows,
+                  unsigned char *qcols)
+{
+    const size_t collen = nrows / 8;
+    unsigned char *u = NULL;
+    double start, end;
+    int err = 0;
+
+    start = current_time();
+
+    u = (unsigned char *) ot_malloc(ncols * collen);
+    if (u == NULL) {
+        err = 1;
+        goto cleanup;
+    }
+    if (expand_seeds(st, seeds, OTEXT_SEEDLEN, ncols, qcols, collen)) {
+        err = 1;
+        goto cleanup;
+    }
+    if (channel_recv(&st->ch, u, ncols * collen) == -1) {
+        err = 1;
+        goto cleanup;
+    }
+    for (unsigned int i = 0; i < ncols; ++i) {
+        if (ot_get_choice(s, i))
+            xorarray(qcols + i * collen, collen, u + i * collen, collen);
+    }
+    end = current_time();
+    fprintf(stderr, "expand seeds: %f\n", end - start);
+
+ cleanup:
+    if (u)
+        ot_free(u);
+
+    return err;
+}
+
+int
+otext_expand_recv(struct state *st, const unsigned char *seeds,
+                  const unsigned char *xcols, size_t xstride,
+                  unsigned int ncols, long nrows, unsigned char *tcols)
+{
+    const size_t collen = nrows / 8;
+    unsigned char *u = NULL;
+    double start, end;
+    int err = 0;
+
+    start = current_time();
+
+    u = (unsigned char *) ot_malloc(ncols * collen);
+    if (u == NULL) {
+        err = 1;
+        goto cleanup;
+    }
+    /* T_i = G(k0_i) and u_i = G(k1_i) first, then u_i ^= T_i ^ x_i */
+    if (expand_seeds(st, seeds, 2 * OTEXT_SEEDLEN, ncols, tcols, collen)
+        || expand_seeds(st, seeds + OTEXT_SEEDLEN, 2 * OTEXT_SEEDLEN, ncols,
+                        u, collen)) {
+        err = 1;
+        goto cleanup;
+    }
+    for (unsigned int i = 0; i < ncols; ++i) {
+        xorarray(u + i * collen, collen, tcols + i * collen, collen);
+        xorarray(u + i * collen, collen, xcols + i * xstride, collen);
+    }
+    if (channel_send(&st->ch, u, ncols * collen) == -1
+        || channel_flush(&st->ch) == -1) {
+        err = 1;
+        goto cleanup;
+    }
+    end = current_time();
+    fprintf(stderr, "expand seeds: %f\n", end - start);
+
+ cleanup:
+    if (u)
+        ot_free(u);
+
+    return err;
+}
@@ -0,0 +1,45 @@
+#ifndef __OTLIB_OTEXT_H__
+#define __OTLIB_OTEXT_H__
+
+#include "state.h"
+
+/*
+ * Base OT seed expansion shared by the OT extension protocols, following
+ * Asharov et al. [1]: the base OTs only transfer 16-byte seeds, and the
+ * column matrices are expanded from them with an AES-CTR PRG G.
+ *
+ * The extension receiver holds seed pairs (k0_i, k1_i), sets column i of T
+ * to G(k0_i) and sends u_i = G(k0_i) ^ G(k1_i) ^ x_i.  The extension sender
+ * holds k_{s_i} and sets column i of Q to G(k_{s_i}) ^ s_i * u_i, which is
+ * T_i ^ s_i * x_i.  For IKNP every x_i is the choice vector r; for KK, x_i
+ * is column i of the codeword matrix.
+ *
+ * [1] "More Efficient Oblivious Transfer and Extensions for Faster Secure
+ *     Computation."  G. Asharov, Y. Lindell, T. Schneider, M. Zohner.
+ *     CCS 2013.
+ */
+
+#define OTEXT_SEEDLEN 16
+
+/*
+ * seeds - ncols seeds of OTEXT_SEEDLEN bytes, the outputs of the base OTs
+ * s - packed base OT choice bits (ncols bits)
+ * qcols - output, ncols columns of nrows bits each
+ */
+int
+otext_expand_send(struct state *st, const unsigned char *seeds,
+                  const unsigned char *s, unsigned int ncols, long nrows,
+                  unsigned char *qcols);
+
+/*
+ * seeds - ncols pairs of OTEXT_SEEDLEN byte seeds, the inputs of the base OTs
+ * xcols - column i of x is at xcols + i * xstride (xstride 0 reuses one
+ *         column for all i)
+ * tcols - output, ncols columns of nrows bits each
+ */
+int
+otext_expand_recv(struct state *st, const unsigned char *seeds,
+                  const unsigned char *xcols, size_t xstride,
+                  unsigned int ncols, long nrows, unsigned char *tcols);
+
+#endif
@@ -1,243 +1,932 @@
 /*
- * Implementation if semi-honest OT extension as detailed by Ishai et al. [1].
+ * Implementation if semi-honest OT extension as detailed by Ishai et al. [1],
+ * and of its maliciously secure variant by Keller et al. [2].
  *
  * Author: Alex J. Malozemoff <amaloz@cs.umd.edu>
  *
  * [1] "Extending Oblivious Transfer Efficiently."
  *     Y. Ishai, J. Kilian, K. Nissim, E. Petrank. CRYPTO 2003.
+ *
+ * [2] "Actively Secure OT Extension with Optimal Overhead."
+ *     M. Keller, E. Orsini, P. Scholl. CRYPTO 2015.
  */
 #include "otext_iknp.h"
 #include "ot.h"
 
+#include "aes.h"
 #include "crypto.h"
+#include "ghash.h"
 #include "net.h"
 #include "state.h"
+#include "threadpool.h"
+#include "transpose.h"
 #include "utils.h"
 
-#include <gmp.h>
-#include <openssl/sha.h>
 #include <string.h>
 
-#define AES_HW
+#define OTEXT_CHUNK 4096        /* number of OTs handled per job */
 
-#if !defined AES_HW && !defined AES_SW && !defined SHA
-#error one of AES_HW, AES_SW, SHA must be defined
-#endif
+#define ERROR { err = 1; goto cleanup; }
 
-#ifdef AES_HW
-#include "aes.h"
-#endif
+/*
+ * A chunk of OTs handled by one worker.  Chunks are assigned to a ring of
+ * slots so that the main thread can send (or receive) them in order while at
+ * most 'nslots' chunks are in flight.
+ */
+struct iknp_slot {
+    const struct state *st;
+    const unsigned char *cols;  /* Q or T, secparam columns */
+    long ncols;                 /* bits per column */
+    unsigned int secparam;
+    unsigned int maxlength;
+    long j0;                    /* first OT of the chunk */
+    unsigned int n;             /* number of OTs in the chunk */
+    block s;                    /* sender only */
+    block delta;                /* sender only, correlated OT */
+    const unsigned char *msgs;  /* sender only, NULL for random OT */
+    const unsigned char *choices; /* receiver only, NULL for random OT */
+    unsigned char *out;         /* output of receiver and of random OT */
+    unsigned char *rows;
+    const unsigned char *allrows; /* KOS only, rows transposed by the check */
+    const AES_KEY *chikey;      /* KOS only, key deriving the chi_j */
+    block sum_t;                /* KOS only, sum of chi_j * t_j (or q_j) */
+    block sum_x;                /* KOS only, sum of chi_j * r_j */
+    block *in;
+    unsigned char *buf;         /* pads (sender) or ciphertexts (receiver) */
+    unsigned char *pads;        /* hash outputs, when not kept in buf */
+    struct completion done;
+};
+
+/*
+ * Loads a row of 'rowlen' bytes into a zero-padded block.
+ */
+static inline block
+load_row(const unsigned char *row, unsigned int rowlen)
+{
+    unsigned char tmp[16];
+
+    (void) memset(tmp, '\0', sizeof tmp);
+    (void) memcpy(tmp, row, rowlen);
+    return _mm_loadu_si128((__m128i *) tmp);
+}
+
+/*
+ * Returns the rows of the chunk, transposing them out of the column matrix
+ * unless the KOS check already did.
+ */
+static const unsigned char *
+chunk_to_rows(struct iknp_slot *slot)
+{
+    const unsigned int rowlen = slot->secparam / 8;
+
+    if (slot->allrows)
+        return slot->allrows + slot->j0 * rowlen;
+    bit_transpose_strided(slot->rows, rowlen,
+                          slot->cols + slot->j0 / 8, slot->ncols / 8,
+                          slot->secparam, slot->n);
+    return slot->rows;
+}
+
+static void
+iknp_send_job(void *arg)
+{
+    struct iknp_slot *slot = (struct iknp_slot *) arg;
+    const unsigned int rowlen = slot->secparam / 8;
+    const unsigned int n = slot->n;
+    const size_t len = 2 * (size_t) n * slot->maxlength;
+    const unsigned char *rows;
+    unsigned char *pads;
+
+    /* random OTs are written straight to the output */
+    if (slot->msgs)
+        pads = slot->buf;
+    else
+        pads = slot->out + 2 * slot->j0 * slot->maxlength;
+
+    rows = chunk_to_rows(slot);
+    /* hash inputs are q_j and q_j \xor s, both with tweak j */
+    for (unsigned int k = 0; k < n; ++k) {
+        slot->in[2 * k] = load_row(&rows[k * rowlen], rowlen);
+        slot->in[2 * k + 1] = _mm_xor_si128(slot->in[2 * k], slot->s);
+    }
+    AES_crhash_messages(slot->in, 2 * n, 2, slot->j0, pads, slot->maxlength,
+                        &slot->st->aeskey);
+    /* messages are laid out exactly as the pads */
+    if (slot->msgs)
+        xorarray(pads, len, slot->msgs + 2 * slot->j0 * slot->maxlength, len);
+    completion_signal(&slot->done);
+}
+
+static void
+iknp_recv_job(void *arg)
+{
+    struct iknp_slot *slot = (struct iknp_slot *) arg;
+    const unsigned int rowlen = slot->secparam / 8;
+    const unsigned int maxlength = slot->maxlength;
+    const unsigned char *rows;
+    unsigned char *pads;
+
+    if (slot->choices)
+        pads = slot->pads;
+    else
+        pads = slot->out + slot->j0 * maxlength;
+
+    rows = chunk_to_rows(slot);
+    /* hash input is t_j with tweak j */
+    for (unsigned int k = 0; k < slot->n; ++k) {
+        slot->in[k] = load_row(&rows[k * rowlen], rowlen);
+    }
+    AES_crhash_messages(slot->in, slot->n, 1, slot->j0, pads, maxlength,
+                        &slot->st->aeskey);
+    for (unsigned int k = 0; slot->choices && k < slot->n; ++k) {
+        int choice = ot_get_choice(slot->choices, slot->j0 + k);
+        unsigned char *msg = slot->out + (slot->j0 + k) * maxlength;
+
+        (void) memcpy(msg, slot->buf + (2 * k + choice) * maxlength, maxlength);
+        xorarray(msg, maxlength, pads + k * maxlength, maxlength);
+    }
+    completion_signal(&slot->done);
+}
+
+/*
+ * Correlated OT: m_0 = H(q_j) goes to the output and the correction
+ * H(q_j) ^ H(q_j ^ s) ^ delta to the first n blocks of the buffer.
+ */
+static void
+iknp_send_cot_job(void *arg)
+{
+    struct iknp_slot *slot = (struct iknp_slot *) arg;
+    const unsigned int rowlen = slot->secparam / 8;
+    block *pads = (block *) slot->pads;
+    block *out = (block *) slot->out + slot->j0;
+    const unsigned char *rows = chunk_to_rows(slot);
+
+    for (unsigned int k = 0; k < slot->n; ++k) {
+        slot->in[2 * k] = load_row(&rows[k * rowlen], rowlen);
+        slot->in[2 * k + 1] = _mm_xor_si128(slot->in[2 * k], slot->s);
+    }
+    AES_crhash_messages(slot->in, 2 * slot->n, 2, slot->j0,
+                        (unsigned char *) pads, sizeof(block),
+                        &slot->st->aeskey);
+    for (unsigned int k = 0; k < slot->n; ++k) {
+        block y = _mm_xor_si128(pads[2 * k], pads[2 * k + 1]);
+
+        _mm_storeu_si128(&out[k], pads[2 * k]);
+        _mm_storeu_si128((block *) slot->buf + k,
+                         _mm_xor_si128(y, slot->delta));
+    }
+    completion_signal(&slot->done);
+}
+
+static void
+iknp_recv_cot_job(void *arg)
+{
+    struct iknp_slot *slot = (struct iknp_slot *) arg;
+    const unsigned int rowlen = slot->secparam / 8;
+    block *pads = (block *) slot->pads;
+    block *out = (block *) slot->out + slot->j0;
+    const unsigned char *rows = chunk_to_rows(slot);
+
+    for (unsigned int k = 0; k < slot->n; ++k) {
+        slot->in[k] = load_row(&rows[k * rowlen], rowlen);
+    }
+    AES_crhash_messages(slot->in, slot->n, 1, slot->j0,
+                        (unsigned char *) pads, sizeof(block),
+                        &slot->st->aeskey);
+    /* out_j = H(t_j) ^ r_j * y_j, without branching on r_j */
+    for (unsigned int k = 0; k < slot->n; ++k) {
+        block mask = _mm_set1_epi8(
+            -(char) ot_get_choice(slot->choices, slot->j0 + k));
+        block y = _mm_loadu_si128((block *) slot->buf + k);
+
+        _mm_storeu_si128(&out[k],
+                         _mm_xor_si128(pads[k], _mm_and_si128(y, mask)));
+    }
+    completion_signal(&slot->done);
+}
+
+/*
+ * KOS correlation check: transposes the chunk into 'allrows' and adds
+ * chi_j * t_j (or chi_j * q_j) and, for the receiver, chi_j * r_j to the
+ * slot's sums, where chi_j = AES_chikey(j) and the product is in GF(2^128).
+ */
+static void
+kos_check_job(void *arg)
+{
+    struct iknp_slot *slot = (struct iknp_slot *) arg;
+    const unsigned int rowlen = slot->secparam / 8;
+    unsigned char *rows = (unsigned char *) slot->allrows + slot->j0 * rowlen;
+    struct gf_wide sum;
+
+    bit_transpose_strided(rows, rowlen, slot->cols + slot->j0 / 8,
+                          slot->ncols / 8, slot->secparam, slot->n);
+    for (unsigned int k = 0; k < slot->n; ++k)
+        slot->in[k] = _mm_set_epi64x(0, slot->j0 + k);
+    AES_ecb_encrypt_blks(slot->in, slot->n, slot->chikey);
+    /* the products are summed unreduced and reduced once per chunk */
+    gf_wide_zero(&sum);
+    if (rowlen == sizeof(block))
+        gf_mul_add_n(&sum, slot->in, (const block *) rows, slot->n);
+    for (unsigned int k = 0; k < slot->n; ++k) {
+        if (rowlen != sizeof(block))
+            gf_mul_add(&sum, slot->in[k], load_row(&rows[k * rowlen], rowlen));
+        if (slot->choices && ot_get_choice(slot->choices, slot->j0 + k))
+            slot->sum_x = _mm_xor_si128(slot->sum_x, slot->in[k]);
+    }
+    slot->sum_t = _mm_xor_si128(slot->sum_t, gf_reduce(&sum));
+    completion_signal(&slot->done);
+}
+
+static void
+free_slots(struct iknp_slot *slots, unsigned int nslots)
+{
+    if (slots == NULL)
+        return;
+    for (unsigned int i = 0; i < nslots; ++i) {
+        if (slots[i].rows)
+            ot_free(slots[i].rows);
+        if (slots[i].in)
+            ot_free(slots[i].in);
+        if (slots[i].buf)
+            ot_free(slots[i].buf);
+        if (slots[i].pads)
+            ot_free(slots[i].pads);
+        completion_cleanup(&slots[i].done);
+    }
+    ot_free(slots);
+}
+
+/*
+ * Allocates 'nslots' slots with room for one chunk each.  'nins' is the number
+ * of hash inputs per OT (two for the sender, one for the receiver).
+ */
+static struct iknp_slot *
+alloc_slots(unsigned int nslots, const struct state *st,
+            const unsigned char *cols, long ncols, unsigned int secparam,
+            unsigned int maxlength, unsigned int nins)
+{
+    struct iknp_slot *slots;
+
+    slots = (struct iknp_slot *) ot_malloc(sizeof(struct iknp_slot) * nslots);
+    if (slots == NULL)
+        return NULL;
+    (void) memset(slots, '\0', sizeof(struct iknp_slot) * nslots);
+    for (unsigned int i = 0; i < nslots; ++i)
+        completion_init(&slots[i].done);
+    for (unsigned int i = 0; i < nslots; ++i) {
+        struct iknp_slot *slot = &slots[i];
+
+        slot->st = st;
+        slot->cols = cols;
+        slot->ncols = ncols;
+        slot->secparam = secparam;
+        slot->maxlength = maxlength;
+        slot->rows = (unsigned char *) ot_malloc(OTEXT_CHUNK * secparam / 8);
+        slot->in = (block *) ot_malloc(sizeof(block) * nins * OTEXT_CHUNK);
+        slot->buf = (unsigned char *) ot_malloc(2 * OTEXT_CHUNK * maxlength);
+        slot->pads = (unsigned char *) ot_malloc(nins * OTEXT_CHUNK * maxlength);
+        if (slot->rows == NULL || slot->in == NULL || slot->buf == NULL
+            || slot->pads == NULL) {
+            free_slots(slots, nslots);
+            return NULL;
+        }
+    }
+    return slots;
+}
+
+static unsigned int
+num_slots(const struct state *st)
+{
+    return 2 * MAX(threadpool_nthreads(st->pool), 1);
+}
+
+/*
+ * Runs 'job' on every chunk of 'n' OTs, with no network traffic.
+ */
+static void
+run_chunks(struct state *st, struct iknp_slot *slots, unsigned int nslots,
+           long n, threadpool_fn job)
+{
+    const long nchunks = (n + OTEXT_CHUNK - 1) / OTEXT_CHUNK;
+
+    for (long c = 0; c < nchunks; ++c) {
+        struct iknp_slot *slot = &slots[c % nslots];
+
+        if (c >= nslots)
+            completion_wait(&slot->done);
+        slot->j0 = c * OTEXT_CHUNK;
+        slot->n = MIN(n - slot->j0, OTEXT_CHUNK);
+        completion_reset(&slot->done);
+        if (threadpool_add_job(st->pool, job, slot) == FAILURE)
+            job(slot);
+    }
+    threadpool_wait(st->pool);
+}
+
+/*
+ * Runs 'job' on every chunk of 'n' OTs and sends the first 'otlen' bytes per
+ * OT of each slot's buffer, in chunk order.
+ */
+static int
+send_chunks(struct state *st, struct iknp_slot *slots, unsigned int nslots,
+            long n, threadpool_fn job, size_t otlen)
+{
+    const long nchunks = (n + OTEXT_CHUNK - 1) / OTEXT_CHUNK;
+    long sent = 0;
+    int err = 0;
 
-#ifdef AES_SW
-static const char *keydata = "abcdefg";
-#endif
+    /*
+     * Chunk c goes to slot c % nslots.  Before a slot is reused, the chunk it
+     * held is waited for and sent, so chunks hit the wire in order.
+     */
+    for (long c = 0; c < nchunks + nslots; ++c) {
+        if (c >= nslots && sent < nchunks) {
+            struct iknp_slot *slot = &slots[sent % nslots];
+
+            completion_wait(&slot->done);
+            if (channel_send(&st->ch, slot->buf, slot->n * otlen) == -1) {
+                err = 1;
+                break;
+            }
+            ++sent;
+        }
+        if (c < nchunks) {
+            struct iknp_slot *slot = &slots[c % nslots];
+
+            slot->j0 = c * OTEXT_CHUNK;
+            slot->n = MIN(n - slot->j0, OTEXT_CHUNK);
+            completion_reset(&slot->done);
+            if (threadpool_add_job(st->pool, job, slot) == FAILURE) {
+                err = 1;
+                break;
+            }
+        }
+    }
+    /* no job may touch the slots once they are freed */
+    threadpool_wait(st->pool);
+    if (!err && channel_flush(&st->ch) == -1)
+        err = 1;
+    return err;
+}
+
+/*
+ * Reads 'otlen' bytes per OT of every chunk of 'n' OTs into a slot, in chunk
+ * order, and hands the slot to 'job'.
+ */
+static int
+recv_chunks(struct state *st, struct iknp_slot *slots, unsigned int nslots,
+            long n, threadpool_fn job, size_t otlen)
+{
+    const long nchunks = (n + OTEXT_CHUNK - 1) / OTEXT_CHUNK;
+    int err = 0;
+
+    for (long c = 0; c < nchunks; ++c) {
+        struct iknp_slot *slot = &slots[c % nslots];
+
+        if (c >= nslots)
+            completion_wait(&slot->done);
+        slot->j0 = c * OTEXT_CHUNK;
+        slot->n = MIN(n - slot->j0, OTEXT_CHUNK);
+        if (channel_recv(&st->ch, slot->buf, slot->n * otlen) == -1) {
+            err = 1;
+            break;
+        }
+        completion_reset(&slot->done);
+        if (threadpool_add_job(st->pool, job, slot) == FAILURE) {
+            err = 1;
+            break;
+        }
+    }
+    threadpool_wait(st->pool);
+    return err;
+}
 
 /*
  * Runs sender operations of IKNP OT extension.
  *
  * st - state information
- * msgs - vector containing messages to send
- * nmsgs - length of vector
+ * msgs - nmsgs * 2 messages of maxlength bytes each (see ot.h)
+ * nmsgs - number of OTs (a multiple of 8)
  * maxlength - max length of each message
- * secparam - security parameter (in *bytes* not bits!)
+ * secparam - security parameter (in bits)
+ * s - packed base OT choice bits (secparam bits)
+ * qcols - base OT outputs, secparam columns of nmsgs bits each
  */
 int
-otext_iknp_send(struct state *st, void *msgs, long nmsgs,
+otext_iknp_send(struct state *st, const unsigned char *msgs, long nmsgs,
                 unsigned int maxlength, unsigned int secparam,
-                char *s, int slen, unsigned char *array,
-                ot_msg_reader msg_reader, ot_item_reader item_reader)
+                const unsigned char *s, const unsigned char *qcols)
 {
     double start, end;
     int err = 0;
-    char *msg = NULL;
-    double htotal = 0.0;
-    double xortotal = 0.0;
-
-    assert(slen <= SHA_DIGEST_LENGTH);
-
-#ifdef AES_HW
-    fprintf(stderr, "OTEXT-IKNP: Using AESNI\n");
-#endif
-#ifdef AES_SW
-    fprintf(stderr, "OTEXT-IKNP: Using AES\n");
-#endif
-#ifdef SHA
-    fprintf(stderr, "OTEXT-IKNP: Using SHA-1\n");
-#endif
-
-#ifdef AES_SW
-    EVP_CIPHER_CTX enc, dec;
-    aes_init((unsigned char *) keydata, strlen(keydata), &enc, &dec);
-#endif
-
-#ifdef AES_HW
-    AES_KEY key;
-    AES_set_encrypt_key((unsigned char *) "abcd", 128, &key);
-#endif
-
-    msg = (char *) ot_malloc(sizeof(char) * maxlength);
-    if (msg == NULL) {
+    struct iknp_slot *slots = NULL;
+    const unsigned int nslots = num_slots(st);
+    block sblk;
+
+    assert(secparam / 8 <= sizeof(block));
+    assert(nmsgs % 8 == 0);
+
+    start = current_time();
+
+    slots = alloc_slots(nslots, st, qcols, nmsgs, secparam, maxlength, 2);
+    if (slots == NULL) {
         err = 1;
         goto cleanup;
     }
+    sblk = load_row(s, secparam / 8);
+    for (unsigned int i = 0; i < nslots; ++i) {
+        slots[i].s = sblk;
+        slots[i].msgs = msgs;
+    }
+    err = send_chunks(st, slots, nslots, nmsgs, iknp_send_job, 2 * maxlength);
+ cleanup:
+    free_slots(slots, nslots);
+    end = current_time();
+    fprintf(stderr, "hash and send (%u threads): %f\n",
+            threadpool_nthreads(st->pool), end - start);
+    channel_print_stats(&st->ch, "OTEXT-IKNP");
+
+    return err;
+}
+
+/*
+ * Runs receiver operations of IKNP OT extension.
+ *
+ * st - state information
+ * choices - packed choice bits (nchoices bits)
+ * nchoices - number of OTs (a multiple of 8)
+ * maxlength - max length of each message
+ * secparam - security parameter (in bits)
+ * tcols - the matrix T, secparam columns of nchoices bits each
+ * out - output buffer of nchoices * maxlength bytes
+ */
+int
+otext_iknp_recv(struct state *st, const unsigned char *choices, long nchoices,
+                unsigned int maxlength, unsigned int secparam,
+                const unsigned char *tcols, unsigned char *out)
+{
+    struct iknp_slot *slots = NULL;
+    const unsigned int nslots = num_slots(st);
+    double start, end;
+    int err = 0;
+
+    assert(secparam / 8 <= sizeof(block));
+    assert(nchoices % 8 == 0);
 
     start = current_time();
-    for (int j = 0; j < nmsgs; ++j) {
-        void *item;
-        double start, end;
-        unsigned char *q;
-
-        item = msg_reader(msgs, j);
-        q = &array[j * secparam];
-
-        for (int i = 0; i < 2; ++i) {
-            char *m = NULL;
-            ssize_t mlen;
-            char hash[SHA_DIGEST_LENGTH];
-
-            start = current_time();
-            (void) memset(hash, '\0', sizeof hash);
-            xorarray((unsigned char *) hash, sizeof hash, q, secparam);
-            if (i == 1) {
-                xorarray((unsigned char *) hash, sizeof hash,
-                         (unsigned char *) s, slen);
-            }
-            end = current_time();
-            xortotal += end - start;
-
-            start = current_time();
-#ifdef AES_HW
-            AES_encrypt_message((unsigned char *) hash, sizeof hash,
-                                (unsigned char *) msg, maxlength, &key);
-#endif
-#ifdef AES_SW
-            int len = sizeof hash;
-            msg = (char *) aes_encrypt(&enc, (unsigned char *) hash, &len);
-#endif
-#ifdef SHA
-            sha1_hash(msg, maxlength, j, (unsigned char *) hash, sizeof hash);
-#endif
-            end = current_time();
-            htotal += end - start;
-
-            item_reader(item, i, &m, &mlen);
-            assert(mlen <= maxlength);
-            start = current_time();
-            xorarray((unsigned char *) msg, maxlength,
-                     (unsigned char *) m, mlen);
-            end = current_time();
-            xortotal += end - start;
-
-            if (send(st->sockfd, msg, maxlength, 0) == -1) {
-                err = 1;
-                goto cleanup;
+
+    slots = alloc_slots(nslots, st, tcols, nchoices, secparam, maxlength, 1);
+    if (slots == NULL) {
+        err = 1;
+        goto cleanup;
+    }
+    for (unsigned int i = 0; i < nslots; ++i) {
+        slots[i].choices = choices;
+        slots[i].out = out;
+    }
+    /* the main thread reads chunks in order and hands them to the workers */
+    err = recv_chunks(st, slots, nslots, nchoices, iknp_recv_job,
+                      2 * maxlength);
+    end = current_time();
+    fprintf(stderr, "hash and receive (%u threads): %f\n",
+            threadpool_nthreads(st->pool), end - start);
+    channel_print_stats(&st->ch, "OTEXT-IKNP");
+
+ cleanup:
+    free_slots(slots, nslots);
+
+    return err;
+}
+
+/*
+ * Runs sender operations of IKNP correlated OT, in which the two messages of
+ * every OT differ by a global 'delta'.  Only y_j = H(q_j) ^ H(q_j ^ s) ^ delta
+ * is sent, one block per OT.
+ *
+ * out - output buffer of nmsgs blocks, receiving m_0; m_1 is m_0 ^ delta
+ */
+int
+otext_iknp_send_correlated(struct state *st, long nmsgs,
+                           unsigned int secparam, const unsigned char *s,
+                           const unsigned char *qcols, block delta,
+                           block *out)
+{
+    struct iknp_slot *slots = NULL;
+    const unsigned int nslots = num_slots(st);
+    block sblk;
+    int err = 0;
+
+    assert(secparam / 8 <= sizeof(block));
+    assert(nmsgs % 8 == 0);
+
+    slots = alloc_slots(nslots, st, qcols, nmsgs, secparam, sizeof(block), 2);
+    if (slots == NULL)
+        ERROR;
+    sblk = load_row(s, secparam / 8);
+    for (unsigned int i = 0; i < nslots; ++i) {
+        slots[i].s = sblk;
+        slots[i].delta = delta;
+        slots[i].out = (unsigned char *) out;
+    }
+    err = send_chunks(st, slots, nslots, nmsgs, iknp_send_cot_job,
+                      sizeof(block));
+    channel_print_stats(&st->ch, "OTEXT-IKNP-COT");
+
+ cleanup:
+    free_slots(slots, nslots);
+
+    return err;
+}
+
+/*
+ * Runs receiver operations of IKNP correlated OT.
+ *
+ * out - output buffer of nchoices blocks, receiving m_0 or m_0 ^ delta
+ */
+int
+otext_iknp_recv_correlated(struct state *st, const unsigned char *choices,
+                           long nchoices, unsigned int secparam,
+                           const unsigned char *tcols, block *out)
+{
+    struct iknp_slot *slots = NULL;
+    const unsigned int nslots = num_slots(st);
+    int err = 0;
+
+    assert(secparam / 8 <= sizeof(block));
+    assert(nchoices % 8 == 0);
+
+    slots = alloc_slots(nslots, st, tcols, nchoices, secparam, sizeof(block),
+                        1);
+    if (slots == NULL)
+        ERROR;
+    for (unsigned int i = 0; i < nslots; ++i) {
+        slots[i].choices = choices;
+        slots[i].out = (unsigned char *) out;
+    }
+    err = recv_chunks(st, slots, nslots, nchoices, iknp_recv_cot_job,
+                      sizeof(block));
+    channel_print_stats(&st->ch, "OTEXT-IKNP-COT");
+
+ cleanup:
+    free_slots(slots, nslots);
+
+    return err;
+}
+
+/*
+ * Runs sender operations of IKNP random OT: no messages are sent, and the
+ * random pads (H(q_j), H(q_j \xor s)) are written to 'out', laid out like the
+ * messages of otext_iknp_send().
+ *
+ * out - output buffer of nmsgs * 2 * maxlength bytes
+ */
+int
+otext_iknp_send_random(struct state *st, long nmsgs, unsigned int maxlength,
+                       unsigned int secparam, const unsigned char *s,
+                       const unsigned char *qcols, unsigned char *out)
+{
+    struct iknp_slot *slots = NULL;
+    const unsigned int nslots = num_slots(st);
+    block sblk;
+    int err = 0;
+
+    assert(secparam / 8 <= sizeof(block));
+    assert(nmsgs % 8 == 0);
+
+    slots = alloc_slots(nslots, st, qcols, nmsgs, secparam, maxlength, 2);
+    if (slots == NULL)
+        ERROR;
+    sblk = load_row(s, secparam / 8);
+    for (unsigned int i = 0; i < nslots; ++i) {
+        slots[i].s = sblk;
+        slots[i].out = out;
+    }
+    run_chunks(st, slots, nslots, nmsgs, iknp_send_job);
+
+ cleanup:
+    free_slots(slots, nslots);
+
+    return err;
+}
+
+/*
+ * Runs receiver operations of IKNP random OT: the pad H(t_j), which equals
+ * the sender's pad for branch r_j, is written to 'out'.
+ *
+ * out - output buffer of nchoices * maxlength bytes
+ */
+int
+otext_iknp_recv_random(struct state *st, long nchoices, unsigned int maxlength,
+                       unsigned int secparam, const unsigned char *tcols,
+                       unsigned char *out)
+{
+    struct iknp_slot *slots = NULL;
+    const unsigned int nslots = num_slots(st);
+    int err = 0;
+
+    assert(secparam / 8 <= sizeof(block));
+    assert(nchoices % 8 == 0);
+
+    slots = alloc_slots(nslots, st, tcols, nchoices, secparam, maxlength, 1);
+    if (slots == NULL)
+        ERROR;
+    for (unsigned int i = 0; i < nslots; ++i)
+        slots[i].out = out;
+    run_chunks(st, slots, nslots, nchoices, iknp_recv_job);
+
+ cleanup:
+    free_slots(slots, nslots);
+
+    return err;
+}
+
+/*
+ * Turns random OTs into chosen-message OTs.  The receiver sends d = c \xor r,
+ * where r are the choice bits of the random OTs, and the sender replies with
+ * y_b = m_b \xor R_{b \xor d} for b = 0, 1.
+ *
+ * msgs - nmsgs * 2 messages of maxlength bytes each
+ * rand - output of otext_iknp_send_random()
+ */
+int
+otext_iknp_derandomize_send(struct state *st, const unsigned char *msgs,
+                            long nmsgs, unsigned int maxlength,
+                            const unsigned char *rand)
+{
+    unsigned char *d = NULL, *ys = NULL;
+    int err = 0;
+
+    d = (unsigned char *) ot_malloc((nmsgs + 7) / 8);
+    if (d == NULL) {
+        err = 1;
+        goto cleanup;
+    }
+    ys = (unsigned char *) ot_malloc(2 * OTEXT_CHUNK * maxlength);
+    if (ys == NULL) {
+        err = 1;
+        goto cleanup;
+    }
+    if (channel_recv(&st->ch, d, (nmsgs + 7) / 8) == -1) {
+        err = 1;
+        goto cleanup;
+    }
+    for (long j0 = 0; j0 < nmsgs; j0 += OTEXT_CHUNK) {
+        unsigned int n = MIN(nmsgs - j0, OTEXT_CHUNK);
+
+        for (unsigned int k = 0; k < n; ++k) {
+            const long j = j0 + k;
+            const int flip = ot_get_choice(d, j);
+
+            for (int b = 0; b < 2; ++b) {
+                unsigned char *y = ys + (2 * k + b) * maxlength;
+
+                (void) memcpy(y, msgs + (2 * j + b) * maxlength, maxlength);
+                xorarray(y, maxlength, rand + (2 * j + (b ^ flip)) * maxlength,
+                         maxlength);
             }
         }
+        if (channel_send(&st->ch, ys, 2 * n * maxlength) == -1) {
+            err = 1;
+            goto cleanup;
+        }
     }
+    if (channel_flush(&st->ch) == -1)
+        err = 1;
+
  cleanup:
-    if (msg)
-        ot_free(msg);
-    end = current_time();
-    fprintf(stderr, "hash and send: %f\n", end - start);
-    fprintf(stderr, "just hash: %f\n", htotal);
-    fprintf(stderr, "just xor: %f\n", xortotal);
+    if (d)
+        ot_free(d);
+    if (ys)
+        ot_free(ys);
 
     return err;
 }
 
+/*
+ * choices - packed choice bits (nchoices bits)
+ * rchoices - packed choice bits used for otext_iknp_recv_random()
+ * rand - output of otext_iknp_recv_random()
+ * out - output buffer of nchoices * maxlength bytes
+ */
 int
-otext_iknp_recv(struct state *st, void *choices, long nchoices,
-                size_t maxlength, unsigned int secparam,
-                unsigned char *array, void *out,
-                ot_choice_reader ot_choice_reader, ot_msg_writer ot_msg_writer)
+otext_iknp_derandomize_recv(struct state *st, const unsigned char *choices,
+                            long nchoices, unsigned int maxlength,
+                            const unsigned char *rchoices,
+                            const unsigned char *rand, unsigned char *out)
 {
-    char *from = NULL, *msg = NULL;
-    double start, end;
+    unsigned char *d = NULL, *ys = NULL;
+    const long dlen = (nchoices + 7) / 8;
     int err = 0;
-    double total = 0.0;
-
-#ifdef AES_HW
-    fprintf(stderr, "OTEXT-IKNP: Using AESNI\n");
-#endif
-#ifdef AES_SW
-    fprintf(stderr, "OTEXT-IKNP: Using AES\n");
-#endif
-#ifdef SHA
-    fprintf(stderr, "OTEXT-IKNP: Using SHA-1\n");
-#endif
-
-#ifdef AES_HW
-    AES_KEY key;
-    AES_set_encrypt_key((unsigned char *) "abcd", 128, &key);
-#endif
-#ifdef AES_SW
-    EVP_CIPHER_CTX enc, dec;
-    aes_init((unsigned char *) keydata, strlen(keydata), &enc, &dec);
-#endif
-
-    from = (char *) ot_malloc(sizeof(char) * maxlength);
-    if (from == NULL) {
+
+    d = (unsigned char *) ot_malloc(dlen);
+    if (d == NULL) {
         err = 1;
         goto cleanup;
     }
-    msg = (char *) ot_malloc(sizeof(char) * maxlength);
-    if (msg == NULL) {
+    ys = (unsigned char *) ot_malloc(2 * OTEXT_CHUNK * maxlength);
+    if (ys == NULL) {
         err = 1;
         goto cleanup;
     }
+    (void) memcpy(d, choices, dlen);
+    xorarray(d, dlen, rchoices, dlen);
+    if (channel_send(&st->ch, d, dlen) == -1) {
+        err = 1;
+        goto cleanup;
+    }
+    for (long j0 = 0; j0 < nchoices; j0 += OTEXT_CHUNK) {
+        unsigned int n = MIN(nchoices - j0, OTEXT_CHUNK);
+
+        if (channel_recv(&st->ch, ys, 2 * n * maxlength) == -1) {
+            err = 1;
+            goto cleanup;
+        }
+        for (unsigned int k = 0; k < n; ++k) {
+            const long j = j0 + k;
+            int choice = ot_get_choice(choices, j);
+            unsigned char *msg = out + j * maxlength;
+
+            (void) memcpy(msg, ys + (2 * k + choice) * maxlength, maxlength);
+            xorarray(msg, maxlength, rand + j * maxlength, maxlength);
+        }
+    }
+
+ cleanup:
+    if (d)
+        ot_free(d);
+    if (ys)
+        ot_free(ys);
+
+    return err;
+}
+
+/*
+ * Runs the KOS check over the 'nrows' rows of the slots' matrix, writing the
+ * transposed rows to 'allrows' for the OTs that follow.  'chi' is the 16-byte
+ * seed of the chi_j, and sums[0] and sums[1] receive the sums of
+ * chi_j * (t_j or q_j) and of chi_j * r_j.
+ */
+static void
+kos_check(struct state *st, struct iknp_slot *slots, unsigned int nslots,
+          long nrows, const unsigned char *chi, unsigned char *allrows,
+          block *sums)
+{
+    AES_KEY chikey;
+
+    AES_set_encrypt_key(chi, 128, &chikey);
+    for (unsigned int i = 0; i < nslots; ++i) {
+        slots[i].allrows = allrows;
+        slots[i].chikey = &chikey;
+        slots[i].sum_t = _mm_setzero_si128();
+        slots[i].sum_x = _mm_setzero_si128();
+    }
+    run_chunks(st, slots, nslots, nrows, kos_check_job);
+    sums[0] = sums[1] = _mm_setzero_si128();
+    for (unsigned int i = 0; i < nslots; ++i) {
+        sums[0] = _mm_xor_si128(sums[0], slots[i].sum_t);
+        sums[1] = _mm_xor_si128(sums[1], slots[i].sum_x);
+        slots[i].chikey = NULL;
+    }
+}
+
+/*
+ * Runs sender operations of maliciously secure OT extension [2]: IKNP with a
+ * check that a random linear combination of the rows is correlated by s.
+ *
+ * msgs - nmsgs * 2 messages of maxlength bytes each (see ot.h)
+ * nmsgs - number of OTs (a multiple of 8)
+ * secparam - security parameter (in bits)
+ * s - packed base OT choice bits (secparam bits)
+ * qcols - base OT outputs, secparam columns of nmsgs + OTEXT_KOS_PAD bits
+ */
+int
+otext_kos_send(struct state *st, const unsigned char *msgs, long nmsgs,
+               unsigned int maxlength, unsigned int secparam,
+               const unsigned char *s, const unsigned char *qcols)
+{
+    const long nrows = nmsgs + OTEXT_KOS_PAD;
+    const unsigned int nslots = num_slots(st);
+    struct iknp_slot *slots = NULL;
+    unsigned char *allrows = NULL;
+    unsigned char chi[sizeof(block)];
+    block sblk, sums[2], theirs[2], xs;
+    double start, end;
+    int err = 0;
+
+    assert(secparam / 8 <= sizeof(block));
+    assert(nmsgs % 8 == 0);
+
+    start = current_time();
+
+    slots = alloc_slots(nslots, st, qcols, nrows, secparam, maxlength, 2);
+    if (slots == NULL)
+        ERROR;
+    allrows = (unsigned char *) ot_malloc(nrows * (secparam / 8));
+    if (allrows == NULL)
+        ERROR;
+
+    /* the chi_j are picked once T is fixed, that is after the expansion */
+    prg_bytes(&st->p.rnd, chi, sizeof chi);
+    if (channel_send(&st->ch, chi, sizeof chi) == -1
+        || channel_flush(&st->ch) == -1)
+        ERROR;
+
+    /* q = sum chi_j q_j must equal t ^ x * s */
+    kos_check(st, slots, nslots, nrows, chi, allrows, sums);
+    if (channel_recv(&st->ch, theirs, sizeof theirs) == -1)
+        ERROR;
+    sblk = load_row(s, secparam / 8);
+    gfmul(theirs[1], sblk, &xs);
+    xs = _mm_xor_si128(xs, theirs[0]);
+    if (memcmp(&xs, &sums[0], sizeof(block)) != 0) {
+        (void) fprintf(stderr, "KOS correlation check failed\n");
+        ERROR;
+    }
 
+    end = current_time();
+    fprintf(stderr, "correlation check: %f\n", end - start);
+
+    /* only the first nmsgs rows are used, the rest padded the check */
     start = current_time();
-    for (int j = 0; j < nchoices; ++j) {
-        int choice;
+    for (unsigned int i = 0; i < nslots; ++i) {
+        slots[i].s = sblk;
+        slots[i].msgs = msgs;
+    }
+    err = send_chunks(st, slots, nslots, nmsgs, iknp_send_job, 2 * maxlength);
+    end = current_time();
+    fprintf(stderr, "hash and send (%u threads): %f\n",
+            threadpool_nthreads(st->pool), end - start);
+    channel_print_stats(&st->ch, "OTEXT-KOS");
 
-        choice = ot_choice_reader(choices, j);
+ cleanup:
+    free_slots(slots, nslots);
+    if (allrows)
+        ot_free(allrows);
 
-        for (int i = 0; i < 2; ++i) {
-            char hash[SHA_DIGEST_LENGTH];
-            unsigned char *t;
+    return err;
+}
 
-            if (recv(st->sockfd, from, maxlength, 0) == -1) {
-                err = 1;
-                goto cleanup;
-            }
+/*
+ * Runs receiver operations of maliciously secure OT extension.
+ *
+ * choices - packed choice bits (nchoices + OTEXT_KOS_PAD bits, the last
+ *           OTEXT_KOS_PAD of them random)
+ * nchoices - number of OTs (a multiple of 8)
+ * tcols - the matrix T, secparam columns of nchoices + OTEXT_KOS_PAD bits
+ * out - output buffer of nchoices * maxlength bytes
+ */
+int
+otext_kos_recv(struct state *st, const unsigned char *choices, long nchoices,
+               unsigned int maxlength, unsigned int secparam,
+               const unsigned char *tcols, unsigned char *out)
+{
+    const long nrows = nchoices + OTEXT_KOS_PAD;
+    const unsigned int nslots = num_slots(st);
+    struct iknp_slot *slots = NULL;
+    unsigned char *allrows = NULL;
+    unsigned char chi[sizeof(block)];
+    block sums[2];
+    double start, end;
+    int err = 0;
 
-            t = &array[j * (secparam / 8)];
-            (void) memset(hash, '\0', sizeof hash);
-            (void) memcpy(hash, t, secparam / 8);
-
-            double start, end;
-            start = current_time();
-#ifdef AES_HW
-            AES_encrypt_message((unsigned char *) hash, sizeof hash,
-                                (unsigned char *) msg, maxlength, &key);
-#endif
-#ifdef AES_SW
-            int len = sizeof hash;
-            msg = (char *) aes_encrypt(&enc, (unsigned char *) hash, &len);
-#endif
-#ifdef SHA
-            sha1_hash(msg, maxlength, j, (unsigned char *) hash,
-                      SHA_DIGEST_LENGTH);
-#endif
-            end = current_time();
-            total += end - start;
-
-            xorarray((unsigned char *) from, maxlength,
-                     (unsigned char *) msg, maxlength);
-            if (i == choice) {
-                ot_msg_writer(out, j, from, maxlength);
-            }
-        }
+    assert(secparam / 8 <= sizeof(block));
+    assert(nchoices % 8 == 0);
+
+    start = current_time();
+
+    slots = alloc_slots(nslots, st, tcols, nrows, secparam, maxlength, 1);
+    if (slots == NULL)
+        ERROR;
+    allrows = (unsigned char *) ot_malloc(nrows * (secparam / 8));
+    if (allrows == NULL)
+        ERROR;
+    for (unsigned int i = 0; i < nslots; ++i) {
+        slots[i].choices = choices;
+        slots[i].out = out;
     }
+
+    if (channel_recv(&st->ch, chi, sizeof chi) == -1)
+        ERROR;
+    kos_check(st, slots, nslots, nrows, chi, allrows, sums);
+    if (channel_send(&st->ch, sums, sizeof sums) == -1
+        || channel_flush(&st->ch) == -1)
+        ERROR;
+
+    end = current_time();
+    fprintf(stderr, "correlation check: %f\n", end - start);
+
+    start = current_time();
+    err = recv_chunks(st, slots, nslots, nchoices, iknp_recv_job,
+                      2 * maxlength);
     end = current_time();
-    fprintf(stderr, "hash and receive: %f\n", end - start);
-    fprintf(stderr, "just hash: %f\n", total);
+    fprintf(stderr, "hash and receive (%u threads): %f\n",
+            threadpool_nthreads(st->pool), end - start);
+    channel_print_stats(&st->ch, "OTEXT-KOS");
 
  cleanup:
-    if (from)
-        ot_free(from);
-    if (msg)
-        ot_free(msg);
+    free_slots(slots, nslots);
+    if (allrows)
+        ot_free(allrows);
 
     return err;
 }
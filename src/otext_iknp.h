@@ -5,16 +5,62 @@
 #include "state.h"
 
 int
-otext_iknp_send(struct state *st, void *msgs, long nmsgs,
-                unsigned int msglength, unsigned int secparam,
-                char *s, int slen, unsigned char *array,
-                ot_msg_reader msg_reader, ot_item_reader item_reader);
+otext_iknp_send(struct state *st, const unsigned char *msgs, long nmsgs,
+                unsigned int maxlength, unsigned int secparam,
+                const unsigned char *s, const unsigned char *qcols);
 
 int
-otext_iknp_recv(struct state *st, void *choices, long nchoices,
-                size_t maxlength, unsigned int secparam,
-                unsigned char *array,
-                void *out,
-                ot_choice_reader choice_reader, ot_msg_writer msg_writer);
+otext_iknp_recv(struct state *st, const unsigned char *choices, long nchoices,
+                unsigned int maxlength, unsigned int secparam,
+                const unsigned char *tcols, unsigned char *out);
+
+int
+otext_iknp_send_random(struct state *st, long nmsgs, unsigned int maxlength,
+                       unsigned int secparam, const unsigned char *s,
+                       const unsigned char *qcols, unsigned char *out);
+
+int
+otext_iknp_recv_random(struct state *st, long nchoices, unsigned int maxlength,
+                       unsigned int secparam, const unsigned char *tcols,
+                       unsigned char *out);
+
+int
+otext_iknp_send_correlated(struct state *st, long nmsgs,
+                           unsigned int secparam, const unsigned char *s,
+                           const unsigned char *qcols, block delta,
+                           block *out);
+
+int
+otext_iknp_recv_correlated(struct state *st, const unsigned char *choices,
+                           long nchoices, unsigned int secparam,
+                           const unsigned char *tcols, block *out);
+
+int
+otext_iknp_derandomize_send(struct state *st, const unsigned char *msgs,
+                            long nmsgs, unsigned int maxlength,
+                            const unsigned char *rand);
+
+int
+otext_iknp_derandomize_recv(struct state *st, const unsigned char *choices,
+                            long nchoices, unsigned int maxlength,
+                            const unsigned char *rchoices,
+                            const unsigned char *rand, unsigned char *out);
+
+/*
+ * Number of extra random OTs the receiver appends to hide its choices from
+ * the KOS correlation check: 128 for GF(2^128) plus a 40-bit statistical
+ * parameter.
+ */
+#define OTEXT_KOS_PAD 168
+
+int
+otext_kos_send(struct state *st, const unsigned char *msgs, long nmsgs,
+               unsigned int maxlength, unsigned int secparam,
+               const unsigned char *s, const unsigned char *qcols);
+
+int
+otext_kos_recv(struct state *st, const unsigned char *choices, long nchoices,
+               unsigned int maxlength, unsigned int secparam,
+               const unsigned char *tcols, unsigned char *out);
 
 #endif
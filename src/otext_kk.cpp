@@ -0,0 +1,401 @@
+/*
+ * Implementation of semi-honest 1-out-of-N OT extension as detailed by
+ * Kolesnikov and Kumaresan [1].
+ *
+ * The IKNP repetition code is replaced by the Walsh-Hadamard code over
+ * OTEXT_KK_CODEBITS bits, whose codewords are at distance 128 from each
+ * other.  Row j of Q satisfies q_j = t_j ^ (C(r_j) & s), so the sender masks
+ * message i of OT j with H(j, q_j ^ (C(i) & s)) and the receiver can only
+ * compute H(j, t_j).
+ *
+ * [1] "Improved OT Extension for Transferring Short Secrets."
+ *     V. Kolesnikov, R. Kumaresan. CRYPTO 2013.
+ */
+#include "otext_kk.h"
+
+#include "aes.h"
+#include "crypto.h"
+#include "net.h"
+#include "threadpool.h"
+#include "transpose.h"
+#include "utils.h"
+
+#include <string.h>
+
+#define KK_ROWLEN (OTEXT_KK_CODEBITS / 8)
+#define KK_CHUNK 256            /* number of OTs handled per job */
+
+/*
+ * A chunk of OTs handled by one worker; see struct iknp_slot.
+ */
+struct kk_slot {
+    const struct state *st;
+    const unsigned char *cols;  /* Q or T */
+    long ncols;                 /* bits per column */
+    int N;
+    unsigned int maxlength;
+    long j0;
+    unsigned int n;
+    const block *cs;            /* sender only, C(i) & s for each i */
+    const unsigned char *msgs;  /* sender only */
+    const unsigned char *choices; /* receiver only */
+    unsigned char *out;         /* receiver only */
+    unsigned char *rows;
+    block *in;
+    unsigned char *buf;         /* pads (sender) or ciphertexts (receiver) */
+    unsigned char *pads;        /* receiver only */
+    struct completion done;
+};
+
+/*
+ * Writes the Walsh-Hadamard codeword of 'i': bit b is the parity of i & b.
+ */
+static void
+codeword(unsigned char *out, unsigned int i)
+{
+    (void) memset(out, '\0', KK_ROWLEN);
+    for (unsigned int b = 0; b < OTEXT_KK_CODEBITS; ++b) {
+        if (__builtin_parity(i & b))
+            ot_set_choice(out, b, 1);
+    }
+}
+
+int
+otext_kk_codeword_columns(unsigned char *cols, const unsigned char *choices,
+                          long nchoices)
+{
+    unsigned char table[OTEXT_KK_MAXN][KK_ROWLEN];
+    unsigned char *rows;
+
+    for (unsigned int i = 0; i < OTEXT_KK_MAXN; ++i)
+        codeword(table[i], i);
+    rows = (unsigned char *) ot_malloc(nchoices * KK_ROWLEN);
+    if (rows == NULL)
+        return FAILURE;
+    for (long j = 0; j < nchoices; ++j)
+        (void) memcpy(rows + j * KK_ROWLEN, table[choices[j]], KK_ROWLEN);
+    bit_transpose(cols, rows, nchoices, OTEXT_KK_CODEBITS);
+    ot_free(rows);
+    return SUCCESS;
+}
+
+/*
+ * Hashes 'n' 256-bit rows, with halves in 'lo' and 'hi', for j = j0 + k /
+ * stride.  The fixed-key hash only takes one block, so each row is first
+ * compressed as v = H(lo, 2j) ^ hi, and v is then hashed to 'maxlength' bytes
+ * as H(v, 2j + 1).  The tweaks keep the inner and outer calls, and the rows of
+ * different OTs, on disjoint inputs of the permutation.
+ *
+ * An unchosen row differs from the receiver's t_j by (C(i) ^ C(r_j)) & s.
+ * Codewords at distance d = i ^ r_j differ in 64 bits of each half if
+ * d mod 128 is nonzero, and in all of the high half otherwise (d = 128).  In
+ * the first case H(lo, 2j) is hit by an offset with 64 unknown bits of s, so
+ * v is pseudorandom by correlation robustness; in the second, v inherits the
+ * 128 unknown bits of the high half directly.  Either way the outer call only
+ * sees inputs offset by an unknown value, which is what correlation
+ * robustness requires.  'lo' is overwritten.
+ */
+static void
+hash_rows(block *lo, const block *hi, unsigned int n, unsigned int stride,
+          long j0, unsigned char *out, unsigned int maxlength,
+          const AES_KEY *key)
+{
+    /* H(x, t) = H(x ^ t, 0), so the tweaks are applied to the inputs and the
+       calls below use tweak 0 for all n messages */
+    for (unsigned int k = 0; k < n; ++k)
+        lo[k] = _mm_xor_si128(lo[k],
+                              _mm_set_epi64x(0, 2 * (j0 + k / stride)));
+    /* with one-block outputs each block is read before it is overwritten */
+    AES_crhash_messages(lo, n, n, 0, (unsigned char *) lo, sizeof(block), key);
+    for (unsigned int k = 0; k < n; ++k)
+        lo[k] = _mm_xor_si128(_mm_xor_si128(lo[k], hi[k]),
+                              _mm_set_epi64x(0, 2 * (j0 + k / stride) + 1));
+    AES_crhash_messages(lo, n, n, 0, out, maxlength, key);
+}
+
+static void
+chunk_to_rows(struct kk_slot *slot)
+{
+    bit_transpose_strided(slot->rows, KK_ROWLEN, slot->cols + slot->j0 / 8,
+                          slot->ncols / 8, OTEXT_KK_CODEBITS, slot->n);
+}
+
+static void
+kk_send_job(void *arg)
+{
+    struct kk_slot *slot = (struct kk_slot *) arg;
+    const unsigned int N = slot->N;
+    const unsigned int nins = slot->n * N;
+    const size_t len = (size_t) nins * slot->maxlength;
+    block *lo = slot->in, *hi = slot->in + KK_CHUNK * N;
+
+    chunk_to_rows(slot);
+    /* hash inputs are q_j ^ (C(i) & s) for each i, all with tweak j */
+    for (unsigned int k = 0; k < slot->n; ++k) {
+        const block *q = (const block *) &slot->rows[k * KK_ROWLEN];
+
+        for (unsigned int i = 0; i < N; ++i) {
+            lo[k * N + i] = _mm_xor_si128(q[0], slot->cs[2 * i]);
+            hi[k * N + i] = _mm_xor_si128(q[1], slot->cs[2 * i + 1]);
+        }
+    }
+    hash_rows(lo, hi, nins, N, slot->j0, slot->buf, slot->maxlength,
+              &slot->st->aeskey);
+    xorarray(slot->buf, len, slot->msgs + slot->j0 * N * slot->maxlength, len);
+    completion_signal(&slot->done);
+}
+
+static void
+kk_recv_job(void *arg)
+{
+    struct kk_slot *slot = (struct kk_slot *) arg;
+    const unsigned int N = slot->N;
+    const unsigned int maxlength = slot->maxlength;
+    block *lo = slot->in, *hi = slot->in + KK_CHUNK;
+
+    chunk_to_rows(slot);
+    /* hash input is t_j with tweak j */
+    for (unsigned int k = 0; k < slot->n; ++k) {
+        const block *t = (const block *) &slot->rows[k * KK_ROWLEN];
+
+        lo[k] = t[0];
+        hi[k] = t[1];
+    }
+    hash_rows(lo, hi, slot->n, 1, slot->j0, slot->pads, maxlength,
+              &slot->st->aeskey);
+    for (unsigned int k = 0; k < slot->n; ++k) {
+        int choice = slot->choices[slot->j0 + k];
+        unsigned char *msg = slot->out + (slot->j0 + k) * maxlength;
+
+        (void) memcpy(msg, slot->buf + (k * N + choice) * maxlength,
+                      maxlength);
+        xorarray(msg, maxlength, slot->pads + k * maxlength, maxlength);
+    }
+    completion_signal(&slot->done);
+}
+
+static void
+free_slots(struct kk_slot *slots, unsigned int nslots)
+{
+    if (slots == NULL)
+        return;
+    for (unsigned int i = 0; i < nslots; ++i) {
+        if (slots[i].rows)
+            ot_free(slots[i].rows);
+        if (slots[i].in)
+            ot_free(slots[i].in);
+        if (slots[i].buf)
+            ot_free(slots[i].buf);
+        if (slots[i].pads)
+            ot_free(slots[i].pads);
+        completion_cleanup(&slots[i].done);
+    }
+    ot_free(slots);
+}
+
+/*
+ * Allocates 'nslots' slots with room for one chunk each.  'nins' is the number
+ * of hash inputs per OT (N for the sender, one for the receiver).
+ */
+static struct kk_slot *
+alloc_slots(unsigned int nslots, const struct state *st,
+            const unsigned char *cols, long ncols, int N,
+            unsigned int maxlength, unsigned int nins)
+{
+    struct kk_slot *slots;
+
+    slots = (struct kk_slot *) ot_malloc(sizeof(struct kk_slot) * nslots);
+    if (slots == NULL)
+        return NULL;
+    (void) memset(slots, '\0', sizeof(struct kk_slot) * nslots);
+    for (unsigned int i = 0; i < nslots; ++i)
+        completion_init(&slots[i].done);
+    for (unsigned int i = 0; i < nslots; ++i) {
+        struct kk_slot *slot = &slots[i];
+
+        slot->st = st;
+        slot->cols = cols;
+        slot->ncols = ncols;
+        slot->N = N;
+        slot->maxlength = maxlength;
+        slot->rows = (unsigned char *) ot_malloc(KK_CHUNK * KK_ROWLEN);
+        slot->in = (block *) ot_malloc(sizeof(block) * 2 * nins * KK_CHUNK);
+        slot->buf = (unsigned char *) ot_malloc(N * KK_CHUNK * maxlength);
+        slot->pads = (unsigned char *) ot_malloc(KK_CHUNK * maxlength);
+        if (slot->rows == NULL || slot->in == NULL || slot->buf == NULL
+            || slot->pads == NULL) {
+            free_slots(slots, nslots);
+            return NULL;
+        }
+    }
+    return slots;
+}
+
+/*
+ * Runs sender operations of KK OT extension.
+ *
+ * st - state information
+ * msgs - nmsgs * N messages of maxlength bytes each (see ot.h)
+ * nmsgs - number of OTs (a multiple of 8)
+ * N - number of messages per OT, at most OTEXT_KK_MAXN
+ * maxlength - max length of each message
+ * s - packed base OT choice bits (OTEXT_KK_CODEBITS bits)
+ * qcols - base OT outputs, OTEXT_KK_CODEBITS columns of nmsgs bits each
+ */
+int
+otext_kk_send(struct state *st, const unsigned char *msgs, long nmsgs, int N,
+              unsigned int maxlength, const unsigned char *s,
+              const unsigned char *qcols)
+{
+    struct kk_slot *slots = NULL;
+    const unsigned int nslots = 2 * MAX(threadpool_nthreads(st->pool), 1);
+    const long nchunks = (nmsgs + KK_CHUNK - 1) / KK_CHUNK;
+    block *cs = NULL;
+    long sent = 0;
+    double start, end;
+    int err = 0;
+
+    assert(N >= 2 && N <= OTEXT_KK_MAXN);
+    assert(nmsgs % 8 == 0);
+
+    start = current_time();
+
+    cs = (block *) ot_malloc(sizeof(block) * 2 * N);
+    if (cs == NULL) {
+        err = 1;
+        goto cleanup;
+    }
+    for (int i = 0; i < N; ++i) {
+        unsigned char c[KK_ROWLEN];
+
+        codeword(c, i);
+        for (int b = 0; b < KK_ROWLEN; ++b)
+            c[b] &= s[b];
+        (void) memcpy(&cs[2 * i], c, KK_ROWLEN);
+    }
+    slots = alloc_slots(nslots, st, qcols, nmsgs, N, maxlength, N);
+    if (slots == NULL) {
+        err = 1;
+        goto cleanup;
+    }
+    for (unsigned int i = 0; i < nslots; ++i) {
+        slots[i].cs = cs;
+        slots[i].msgs = msgs;
+    }
+
+    /* chunks are sent in order as in otext_iknp_send() */
+    for (long c = 0; c < nchunks + nslots; ++c) {
+        if (c >= nslots && sent < nchunks) {
+            struct kk_slot *slot = &slots[sent % nslots];
+
+            completion_wait(&slot->done);
+            if (channel_send(&st->ch, slot->buf,
+                             (size_t) slot->n * N * maxlength) == -1) {
+                err = 1;
+                break;
+            }
+            ++sent;
+        }
+        if (c < nchunks) {
+            struct kk_slot *slot = &slots[c % nslots];
+
+            slot->j0 = c * KK_CHUNK;
+            slot->n = MIN(nmsgs - slot->j0, KK_CHUNK);
+            completion_reset(&slot->done);
+            if (threadpool_add_job(st->pool, kk_send_job, slot) == FAILURE) {
+                err = 1;
+                break;
+            }
+        }
+    }
+    threadpool_wait(st->pool);
+    if (!err && channel_flush(&st->ch) == -1)
+        err = 1;
+
+ cleanup:
+    free_slots(slots, nslots);
+    if (cs)
+        ot_free(cs);
+    end = current_time();
+    fprintf(stderr, "hash and send (%u threads): %f\n",
+            threadpool_nthreads(st->pool), end - start);
+    channel_print_stats(&st->ch, "OTEXT-KK");
+
+    return err;
+}
+
+/*
+ * Runs receiver operations of KK OT extension.
+ *
+ * st - state information
+ * choices - one choice in [0, N) per byte
+ * nchoices - number of OTs (a multiple of 8)
+ * N - number of messages per OT
+ * maxlength - max length of each message
+ * tcols - the matrix T, OTEXT_KK_CODEBITS columns of nchoices bits each
+ * out - output buffer of nchoices * maxlength bytes
+ */
+int
+otext_kk_recv(struct state *st, const unsigned char *choices, long nchoices,
+              int N, unsigned int maxlength, const unsigned char *tcols,
+              unsigned char *out)
+{
+    struct kk_slot *slots = NULL;
+    const unsigned int nslots = 2 * MAX(threadpool_nthreads(st->pool), 1);
+    const long nchunks = (nchoices + KK_CHUNK - 1) / KK_CHUNK;
+    double start, end;
+    int err = 0;
+
+    assert(N >= 2 && N <= OTEXT_KK_MAXN);
+    assert(nchoices % 8 == 0);
+
+    /* a choice of N or more would copy from past the chunk ciphertexts */
+    for (long j = 0; j < nchoices; ++j) {
+        if (choices[j] >= N) {
+            (void) fprintf(stderr, "invalid choice %d for OT %ld\n",
+                           choices[j], j);
+            return 1;
+        }
+    }
+
+    start = current_time();
+
+    slots = alloc_slots(nslots, st, tcols, nchoices, N, maxlength, 1);
+    if (slots == NULL) {
+        err = 1;
+        goto cleanup;
+    }
+    for (unsigned int i = 0; i < nslots; ++i) {
+        slots[i].choices = choices;
+        slots[i].out = out;
+    }
+
+    for (long c = 0; c < nchunks; ++c) {
+        struct kk_slot *slot = &slots[c % nslots];
+
+        if (c >= nslots)
+            completion_wait(&slot->done);
+        slot->j0 = c * KK_CHUNK;
+        slot->n = MIN(nchoices - slot->j0, KK_CHUNK);
+        if (channel_recv(&st->ch, slot->buf,
+                         (size_t) slot->n * N * maxlength) == -1) {
+            err = 1;
+            break;
+        }
+        completion_reset(&slot->done);
+        if (threadpool_add_job(st->pool, kk_recv_job, slot) == FAILURE) {
+            err = 1;
+            break;
+        }
+    }
+    threadpool_wait(st->pool);
+    end = current_time();
+    fprintf(stderr, "hash and receive (%u threads): %f\n",
+            threadpool_nthreads(st->pool), end - start);
+    channel_print_stats(&st->ch, "OTEXT-KK");
+
+ cleanup:
+    free_slots(slots, nslots);
+
+    return err;
+}
@@ -0,0 +1,28 @@
+#ifndef __OTLIB_OTEXT_KK_H__
+#define __OTLIB_OTEXT_KK_H__
+
+#include "ot.h"
+#include "state.h"
+
+#define OTEXT_KK_CODEBITS 256   /* codeword length, and number of base OTs */
+#define OTEXT_KK_MAXN 256       /* largest supported N */
+
+/*
+ * Writes the OTEXT_KK_CODEBITS columns of the codeword matrix whose row j is
+ * the codeword of 'choices[j]'; each column is nchoices bits.
+ */
+int
+otext_kk_codeword_columns(unsigned char *cols, const unsigned char *choices,
+                          long nchoices);
+
+int
+otext_kk_send(struct state *st, const unsigned char *msgs, long nmsgs, int N,
+              unsigned int maxlength, const unsigned char *s,
+              const unsigned char *qcols);
+
+int
+otext_kk_recv(struct state *st, const unsigned char *choices, long nchoices,
+              int N, unsigned int maxlength, const unsigned char *tcols,
+              unsigned char *out);
+
+#endif
@@ -2,6 +2,13 @@
  * Implementation of maliciously secure OT extension as detailed by Frederiksen
  * and Nielsen [1], which is based on the approach of Nielsen et al. [2].
  *
+ * The base OT seeds are expanded as for IKNP (see otext.h), over about
+ * 8/3 * secparam columns.  The sender then pairs up the columns at random and
+ * reveals the xor of its choice bits within each pair; the receiver proves
+ * that it used the same choice vector for both columns of every pair by
+ * returning a hash of their xors.  One column of each pair is discarded and
+ * the remaining ones are used as in IKNP.
+ *
  * Author: Alex J. Malozemoff <amaloz@cs.umd.edu>
  *
  * [1] "Fast and Maliciously Secure Two-Party Computation Usign the GPU."
@@ -13,262 +20,227 @@
  *     Full version: https://eprint.iacr.org/2011/091
  */
 #include "otext_nnob.h"
-
-#include <math.h>
+#include "otext_iknp.h"
 
 #include "crypto.h"
 #include "net.h"
 #include "state.h"
 #include "utils.h"
 
-#define ERROR { err = 1; goto cleanup; }
-
-PyObject *
-otext_nnob_send(PyObject *self, PyObject *args)
-{
-    PyObject *py_state, *py_rbits, *py_ells;
-    unsigned int secparam, num, seed;
-    char *Ls = NULL, *bitstring = NULL, *Zs = NULL;
-    unsigned int *perm = NULL, *S = NULL, *D = NULL;
-    struct state *st;
-    long m, err = 0;
-
-    if (!PyArg_ParseTuple(args, "OOI", &py_state, &py_rbits, &py_ells, &secparam))
-        return NULL;
-
-    st = (struct state *) PyCapsule_GetPointer(py_state, NULL);
-    if (st == NULL)
-        return NULL;
-
-    if ((m = PySequence_Length(py_rbits)) == -1)
-        return NULL;
+#include <string.h>
 
-    num = ceil(8.0 / 3.0 * secparam);
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/sha.h>
 
-    Ls = (char *) malloc(m * num / 8);
-    if (Ls == NULL)
-        ERROR;
-    bitstring = (char *) malloc(m * num / 8);
-    if (bitstring == NULL)
-        ERROR;
-
-    /* Step 5 */
+#define ERROR { err = 1; goto cleanup; }
 
-    for (unsigned int i = 0; i < num; ++i) {
-        char *L, *ell;
-        Py_ssize_t len;
+unsigned int
+otext_nnob_ncols(unsigned int secparam)
+{
+    unsigned int ncols = (8 * secparam + 2) / 3;
 
-        (void) PyBytes_AsStringAndSize(PySequence_GetItem(py_ells, i), &ell, &len);
-        assert(len == secparam / 8);
-        L = Ls + i * m / 8;
+    return (ncols + 15) / 16 * 16;
+}
 
-        for (int j = 0; j < m / secparam; ++j) {
-            sha1_hash(L + j * secparam / 8, secparam / 8,
-                      i * m / secparam + j, (unsigned char *) ell, len);
-        }
+/*
+ * Hashes Z_k = X_i ^ X_{pair[i]} ^ d_k * x over the pairs (i, pair[i]) with
+ * i < pair[i], taken in increasing order of i, where X is Q or T.  If 'x' is
+ * NULL the d_k * x term is left out.
+ */
+static int
+hash_pairs(unsigned char *digest, const unsigned char *cols, size_t collen,
+           const unsigned int *pair, unsigned int ncols, const unsigned char *d,
+           const unsigned char *x)
+{
+    unsigned char *z;
+    EVP_MD_CTX *ctx;
+
+    z = (unsigned char *) ot_malloc(collen);
+    if (z == NULL)
+        return FAILURE;
+    ctx = EVP_MD_CTX_new();
+    if (ctx == NULL) {
+        ot_free(z);
+        return FAILURE;
     }
+    (void) EVP_DigestInit_ex(ctx, EVP_sha256(), NULL);
+    for (unsigned int i = 0, k = 0; i < ncols; ++i) {
+        if (pair[i] < i)
+            continue;
+        (void) memcpy(z, cols + i * collen, collen);
+        xorarray(z, collen, cols + pair[i] * collen, collen);
+        if (x && ot_get_choice(d, k))
+            xorarray(z, collen, x, collen);
+        (void) EVP_DigestUpdate(ctx, z, collen);
+        ++k;
+    }
+    (void) EVP_DigestFinal_ex(ctx, digest, NULL);
+    EVP_MD_CTX_free(ctx);
+    ot_free(z);
+    return SUCCESS;
+}
 
-    /* Step 7 */
+/*
+ * Copies the first column of every pair (the one with the smaller index) to
+ * 'out', and its bit of 's' to 'sout' if 's' is not NULL.
+ */
+static void
+keep_columns(unsigned char *out, unsigned char *sout,
+             const unsigned char *cols, const unsigned char *s,
+             size_t collen, const unsigned int *pair, unsigned int ncols)
+{
+    for (unsigned int i = 0, k = 0; i < ncols; ++i) {
+        if (pair[i] < i)
+            continue;
+        (void) memcpy(out + k * collen, cols + i * collen, collen);
+        if (s)
+            ot_set_choice(sout, k, ot_get_choice(s, i));
+        ++k;
+    }
+}
 
-    if (pyrecv(st->sockfd, bitstring, m * num / 8, 0) == -1)
-        ERROR;
+int
+otext_nnob_send(struct state *st, const unsigned char *msgs, long nmsgs,
+                unsigned int maxlength, unsigned int secparam,
+                const unsigned char *s, const unsigned char *qcols)
+{
+    const unsigned int ncols = otext_nnob_ncols(secparam);
+    const size_t collen = nmsgs / 8;
+    unsigned int *pair = NULL;
+    unsigned char d[ncols / 16], skept[ncols / 16];
+    unsigned char digest[SHA256_DIGEST_LENGTH], theirs[SHA256_DIGEST_LENGTH];
+    unsigned char *qkept = NULL;
+    int err = 0;
+    double start, end;
 
-    xorarray((unsigned char *) Ls, m * num / 8,
-             (unsigned char *) bitstring, m * num / 8);
+    assert(secparam <= OTEXT_NNOB_MAXSECPARAM);
 
-    /* Step 8 */
+    start = current_time();
 
-    seed = gmp_urandomb_ui(st->p.rnd, sizeof(unsigned int) * 8);
-    perm = (unsigned int *) malloc(sizeof(unsigned int) * num);
-    if (perm == NULL)
+    pair = (unsigned int *) ot_malloc(sizeof(unsigned int) * ncols);
+    if (pair == NULL)
         ERROR;
-    S = (unsigned int *) malloc(sizeof(unsigned int) * num / 2);
-    if (S == NULL)
-        ERROR;
-    (void) random_permutation(perm, num, S, seed);
-    if (pysend(st->sockfd, perm, sizeof(unsigned int) * num, 0) == -1)
-        ERROR;
-    if (pysend(st->sockfd, S, sizeof(unsigned int) * num / 2, 0) == -1)
+    qkept = (unsigned char *) ot_malloc(ncols / 2 * collen);
+    if (qkept == NULL)
         ERROR;
 
-    /* Step 9 */
+    /* Step 8: pair up the columns at random */
 
-    D = (unsigned int *) malloc(sizeof(unsigned int) * num / 2);
-    if (D == NULL)
+    if (random_permutation(pair, ncols, NULL, &st->p.rnd) == FAILURE)
+        ERROR;
+    if (channel_send(&st->ch, pair, sizeof(unsigned int) * ncols) == -1)
         ERROR;
 
-    /* Step 9a */
-
-    for (unsigned int i = 0; i < num / 2; ++i) {
-        unsigned int j, k, bit, pbit;
+    /* Step 9a: reveal s_i ^ s_{pair[i]} for each pair */
 
-        bit = (unsigned int) PyLong_AsLong(PySequence_GetItem(py_rbits, i));
-        j = perm[S[i]];
-        pbit = (unsigned int) PyLong_AsLong(PySequence_GetItem(py_rbits, j));
-        bit ^= pbit;
-        j = i / (8 * sizeof(unsigned int));
-        k = i % (8 * sizeof(unsigned int));
-        D[j] |= bit << k;
+    (void) memset(d, '\0', sizeof d);
+    for (unsigned int i = 0, k = 0; i < ncols; ++i) {
+        if (pair[i] < i)
+            continue;
+        ot_set_choice(d, k++, ot_get_choice(s, i) ^ ot_get_choice(s, pair[i]));
     }
-    if (pysend(st->sockfd, D, sizeof(unsigned int) * num / 2, 0) == -1)
+    if (channel_send(&st->ch, d, sizeof d) == -1
+        || channel_flush(&st->ch) == -1)
         ERROR;
 
-    /* Step 9b */
+    /* Step 9b: Q_i ^ Q_{pair[i]} = T_i ^ T_{pair[i]} ^ d * r for an honest
+       receiver */
 
-    Zs = (char *) malloc(m * num / 8);
-    if (Zs == NULL)
+    if (hash_pairs(digest, qcols, collen, pair, ncols, d, NULL) == FAILURE)
+        ERROR;
+    if (channel_recv(&st->ch, theirs, sizeof theirs) == -1)
+        ERROR;
+    if (CRYPTO_memcmp(digest, theirs, sizeof digest) != 0) {
+        (void) fprintf(stderr, "NNOB consistency check failed\n");
         ERROR;
-
-    for (unsigned int i = 0; i < num / 2; ++i) {
-        char *L, *Lp, *Z;
-        long xi, xpi;
-
-        xi = PyLong_AsLong(PySequence_GetItem(py_rbits, i));
-        xpi = perm[S[i]];
-
-        L = Ls + xi * m / 8;
-        Lp = Ls + xpi * m / 8;
-        Z = Zs + i * m / 8;
-
-        memcpy(Z, L, m / 8);
-        xorarray((unsigned char *) Z, m / 8, (unsigned char *) Lp, m / 8);
     }
 
-    /* Step 10 */
+    /* Step 10: drop the second column of each pair */
 
-    /* Step 11 */
+    (void) memset(skept, '\0', sizeof skept);
+    keep_columns(qkept, skept, qcols, s, collen, pair, ncols);
 
-    /* Step 13 */
+    end = current_time();
+    fprintf(stderr, "consistency check: %f\n", end - start);
 
-    /* Step 15 */
+    /* Steps 11-15: IKNP over the remaining columns */
+
+    err = otext_iknp_send(st, msgs, nmsgs, maxlength, ncols / 2, skept,
+                          qkept);
 
  cleanup:
-    if (bitstring)
-        free(bitstring);
-    if (Ls)
-        free(Ls);
-    if (perm)
-        free(perm);
-    if (S)
-        free(S);
-    if (D)
-        free(D);
-    if (Zs)
-        free(Zs);
-
-    if (err)
-        return NULL;
-    else
-        Py_RETURN_NONE;
+    if (pair)
+        ot_free(pair);
+    if (qkept)
+        ot_free(qkept);
+
+    return err;
 }
 
-PyObject *
-otext_nnob_receive(PyObject *self, PyObject *args)
+int
+otext_nnob_recv(struct state *st, const unsigned char *choices, long nchoices,
+                unsigned int maxlength, unsigned int secparam,
+                const unsigned char *tcols, unsigned char *out)
 {
-    PyObject *py_state, *py_choicestr, *py_seeds;
-    unsigned int secparam, num;
-    char *Lzeros = NULL, *Lones = NULL, *bitstring = NULL;
-    char *choicestr;
-    Py_ssize_t choicestrlen;
-    struct state *st;
-    long m, err = 0;
-
-    if (!PyArg_ParseTuple(args, "OOOI", &py_state, &py_choicestr, &py_seeds,
-                          &secparam))
-        return NULL;
-
-    st = (struct state *) PyCapsule_GetPointer(py_state, NULL);
-    if (st == NULL)
-        return NULL;
-
-    if ((m = PySequence_Length(py_choicestr)) == -1)
-        return NULL;
-    assert(m >= secparam);
-
-    num = ceil(8.0 / 3.0 * secparam);
-
-    Lzeros = (char *) malloc(m * num / 8);
-    if (Lzeros == NULL) {
-        err = 1;
-        goto cleanup;
-    }
-    Lones = (char *) malloc(m * num / 8);
-    if (Lones == NULL) {
-        err = 1;
-        goto cleanup;
-    }
-    bitstring = (char *) malloc(m * num / 8);
-    if (bitstring == NULL) {
-        err = 1;
-        goto cleanup;
-    }
+    const unsigned int ncols = otext_nnob_ncols(secparam);
+    const size_t collen = nchoices / 8;
+    unsigned int *pair = NULL;
+    unsigned char d[ncols / 16];
+    unsigned char digest[SHA256_DIGEST_LENGTH];
+    unsigned char *tkept = NULL;
+    int err = 0;
+    double start, end;
 
-    /* Step 4 */
+    assert(secparam <= OTEXT_NNOB_MAXSECPARAM);
 
-    for (unsigned int i = 0; i < num; ++i) {
-        char *Lzero, *Lone;
+    start = current_time();
 
-        Lzero = Lzeros + i * (m / 8);
-        Lone = Lones + i * (m / 8);
+    pair = (unsigned int *) ot_malloc(sizeof(unsigned int) * ncols);
+    if (pair == NULL)
+        ERROR;
+    tkept = (unsigned char *) ot_malloc(ncols / 2 * collen);
+    if (tkept == NULL)
+        ERROR;
 
-        for (int j = 0; j < m / secparam; ++j) {
-            for (int b = 0; b <= 1; ++b) {
-                char *seed;
-                Py_ssize_t len;
+    /* Step 8 */
 
-                (void) PyBytes_AsStringAndSize(PySequence_GetItem(PySequence_GetItem(py_seeds, i), b),
-                                               &seed, &len);
-                assert(len == secparam / 8);
-                sha1_hash((b ? Lone : Lzero) + j * secparam / 8, secparam / 8,
-                          i * m / secparam + j, (unsigned char *) seed, len);
-            }
+    if (channel_recv(&st->ch, pair, sizeof(unsigned int) * ncols) == -1)
+        ERROR;
+    for (unsigned int i = 0; i < ncols; ++i) {
+        if (pair[i] >= ncols || pair[i] == i || pair[pair[i]] != i) {
+            (void) fprintf(stderr, "invalid pairing from sender\n");
+            ERROR;
         }
     }
 
-    /* Step 6 */
-
-    (void) PyBytes_AsStringAndSize(py_choicestr, &choicestr, &choicestrlen);
-    assert(choicestrlen == m / 8);
-
-    for (unsigned int i = 0; i < num; ++i) {
-        char *entry, *Lzero, *Lone;
-
-        entry = bitstring + i * m / 8;
-        Lzero = Lzeros + i * m / 8;
-        Lone = Lones + i * m / 8;
-
-        /* Compute L_i^0 \xor L_i^1 \xor choicestr */
-
-        memcpy(entry, Lzero, m / 8);
-        xorarray((unsigned char *) entry, m / 8,
-                 (unsigned char *) Lone, m / 8);
-        xorarray((unsigned char *) entry, m / 8,
-                 (unsigned char *) choicestr, m / 8);
-    }
+    /* Step 9 */
 
-    if (pysend(st->sockfd, bitstring, m * num / 8, 0) == -1)
+    if (channel_recv(&st->ch, d, sizeof d) == -1)
+        ERROR;
+    if (hash_pairs(digest, tcols, collen, pair, ncols, d, choices) == FAILURE)
+        ERROR;
+    if (channel_send(&st->ch, digest, sizeof digest) == -1
+        || channel_flush(&st->ch) == -1)
         ERROR;
 
-    /* Step 8 */
+    /* Step 10 */
 
-    /* Step 9 */
+    keep_columns(tkept, NULL, tcols, NULL, collen, pair, ncols);
 
-    /* Step 10 */
+    end = current_time();
+    fprintf(stderr, "consistency check: %f\n", end - start);
 
-    /* Step 12 */
+    /* Steps 11-15 */
 
-    /* Step 14 */
+    err = otext_iknp_recv(st, choices, nchoices, maxlength, ncols / 2, tkept,
+                          out);
 
  cleanup:
-    if (Lzeros)
-        free(Lzeros);
-    if (Lones)
-        free(Lones);
-    if (bitstring)
-        free(bitstring);
-
-    if (err)
-        return NULL;
-    else
-        return NULL;
+    if (pair)
+        ot_free(pair);
+    if (tkept)
+        ot_free(tkept);
+
+    return err;
 }
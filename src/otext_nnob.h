@@ -1,12 +1,41 @@
 #ifndef __OTLIB_OTEXT_NNOB_H__
 #define __OTLIB_OTEXT_NNOB_H__
 
-#include <Python.h>
+#include "ot.h"
+#include "state.h"
 
-PyObject *
-otext_nnob_send(PyObject *self, PyObject *args);
+/*
+ * Largest security parameter supported: the columns kept after the pairing
+ * check must fit in the 128-bit rows used by the IKNP code.
+ */
+#define OTEXT_NNOB_MAXSECPARAM 96
 
-PyObject *
-otext_nnob_receive(PyObject *self, PyObject *args);
+/*
+ * Number of base OTs (columns) used for 'secparam', about 8/3 * secparam,
+ * rounded up so that the half kept after the check is a whole number of
+ * bytes.
+ */
+unsigned int
+otext_nnob_ncols(unsigned int secparam);
+
+/*
+ * msgs - nmsgs pairs of messages (see ot.h)
+ * s - packed base OT choice bits (otext_nnob_ncols(secparam) bits)
+ * qcols - expanded base OT outputs (see otext.h), one column per base OT
+ */
+int
+otext_nnob_send(struct state *st, const unsigned char *msgs, long nmsgs,
+                unsigned int maxlength, unsigned int secparam,
+                const unsigned char *s, const unsigned char *qcols);
+
+/*
+ * choices - packed choice bits, the same vector used for the expansion
+ * tcols - expanded base OT inputs (see otext.h), one column per base OT
+ * out - output, nchoices * maxlength bytes
+ */
+int
+otext_nnob_recv(struct state *st, const unsigned char *choices, long nchoices,
+                unsigned int maxlength, unsigned int secparam,
+                const unsigned char *tcols, unsigned char *out);
 
 #endif
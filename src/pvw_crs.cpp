@@ -0,0 +1,332 @@
+#include "pvw_crs.h"
+
+#include "utils.h"
+
+#include <openssl/evp.h>
+#include <openssl/sha.h>
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define CRS_MAGIC "OTLIBCRS"
+#define CRS_LABEL "otlib PVW CRS"  /* domain separator for hash_to_subgroup */
+
+/*
+ * Layout of the cache file: this header, followed by p, q, g0, h0, g1, h1 and
+ * the tables of g0, h0, g1 and h1, every number stored as 'nlimbs' native
+ * limbs, least significant first.
+ */
+struct crs_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t nlimbs;
+    uint32_t qbits;
+    uint32_t window;
+    uint32_t unused[2];
+};
+
+static size_t
+table_entries(unsigned int qbits)
+{
+    return (size_t) ((qbits + FBTABLE_WINDOW - 1) / FBTABLE_WINDOW)
+        << FBTABLE_WINDOW;
+}
+
+static size_t
+cache_length(size_t nlimbs, unsigned int qbits)
+{
+    return sizeof(struct crs_header)
+        + (6 + 4 * table_entries(qbits)) * nlimbs * sizeof(mp_limb_t);
+}
+
+static void
+put_u32(unsigned char *buf, uint32_t x)
+{
+    buf[0] = x >> 24;
+    buf[1] = x >> 16;
+    buf[2] = x >> 8;
+    buf[3] = x;
+}
+
+/*
+ * Hashes the label 'idx' into the order-q subgroup: h is the concatenation of
+ * SHA-256(CRS_LABEL, idx, ctr, k) for k = 0, 1, ..., taken 128 bits longer
+ * than p so that h mod p is close to uniform, and g = h^((p - 1) / q).  'ctr'
+ * starts at 0 and is incremented until g is not 1.  The discrete logarithm of
+ * g to any other base is as unknown as for a random element.
+ */
+static int
+hash_to_subgroup(mpz_t g, const struct params *p, uint32_t idx)
+{
+    const size_t blkbits = 8 * SHA256_DIGEST_LENGTH;
+    const size_t nblks = (mpz_sizeinbase(p->p, 2) + 128 + blkbits - 1)
+        / blkbits;
+    unsigned char buf[nblks * SHA256_DIGEST_LENGTH];
+    unsigned char in[12];
+    EVP_MD_CTX *ctx;
+    mpz_t exp;
+
+    ctx = EVP_MD_CTX_new();
+    if (ctx == NULL)
+        return FAILURE;
+    mpz_init(exp);
+    mpz_sub_ui(exp, p->p, 1);
+    mpz_divexact(exp, exp, p->q);
+    put_u32(in, idx);
+    for (uint32_t ctr = 0; ; ++ctr) {
+        put_u32(in + 4, ctr);
+        for (uint32_t k = 0; k < nblks; ++k) {
+            put_u32(in + 8, k);
+            (void) EVP_DigestInit_ex(ctx, EVP_sha256(), NULL);
+            (void) EVP_DigestUpdate(ctx, CRS_LABEL, sizeof CRS_LABEL);
+            (void) EVP_DigestUpdate(ctx, in, sizeof in);
+            (void) EVP_DigestFinal_ex(ctx, buf + k * SHA256_DIGEST_LENGTH,
+                                      NULL);
+        }
+        mpz_import(g, sizeof buf, 1, 1, 0, 0, buf);
+        mpz_mod(g, g, p->p);
+        mpz_powm(g, g, exp, p->p);
+        /* rejects 1, and 0 for h = 0 */
+        if (mpz_cmp_ui(g, 1) > 0)
+            break;
+    }
+    mpz_clear(exp);
+    EVP_MD_CTX_free(ctx);
+    return SUCCESS;
+}
+
+/*
+ * Derives the four elements of the CRS, labeled 0 to 3.
+ */
+static int
+crs_compute(struct pvw_crs *crs, const struct params *p)
+{
+    const unsigned int qbits = mpz_sizeinbase(p->q, 2);
+    mpz_t *elems[4] = { &crs->g0, &crs->h0, &crs->g1, &crs->h1 };
+
+    mpz_inits(crs->g0, crs->h0, crs->g1, crs->h1, NULL);
+    crs->ready = 1;
+    for (uint32_t i = 0; i < 4; ++i) {
+        if (hash_to_subgroup(*elems[i], p, i) == FAILURE) {
+            pvw_crs_cleanup(crs);
+            return FAILURE;
+        }
+    }
+
+    if (fbtable_init(&crs->g0tab, crs->g0, p->p, qbits) == FAILURE
+        || fbtable_init(&crs->h0tab, crs->h0, p->p, qbits) == FAILURE
+        || fbtable_init(&crs->g1tab, crs->g1, p->p, qbits) == FAILURE
+        || fbtable_init(&crs->h1tab, crs->h1, p->p, qbits) == FAILURE) {
+        pvw_crs_cleanup(crs);
+        return FAILURE;
+    }
+    return SUCCESS;
+}
+
+static int
+write_number(FILE *f, const mpz_t x, size_t nlimbs)
+{
+    mp_limb_t limbs[nlimbs];
+
+    assert(mpz_size(x) <= nlimbs);
+    (void) memset(limbs, '\0', sizeof limbs);
+    (void) mpz_export(limbs, NULL, -1, sizeof(mp_limb_t), 0, 0, x);
+    return fwrite(limbs, sizeof limbs, 1, f) == 1 ? SUCCESS : FAILURE;
+}
+
+static int
+write_table(FILE *f, const struct fbtable *t, size_t nlimbs)
+{
+    for (unsigned int i = 0; i < t->nwindows << FBTABLE_WINDOW; ++i) {
+        if (write_number(f, t->table[i], nlimbs) == FAILURE)
+            return FAILURE;
+    }
+    return SUCCESS;
+}
+
+/*
+ * Writes the computed CRS to 'path'.  The file is written under a temporary
+ * name and renamed, so a concurrent reader never sees a partial file.
+ */
+static int
+write_cache(const struct pvw_crs *crs, const struct params *p,
+            const char *path)
+{
+    struct crs_header hdr;
+    const size_t nlimbs = mpz_size(p->p);
+    char tmp[4096];
+    FILE *f;
+    int err = 0;
+
+    if (snprintf(tmp, sizeof tmp, "%s.%ld", path, (long) getpid())
+        >= (int) sizeof tmp)
+        return FAILURE;
+    if ((f = fopen(tmp, "wb")) == NULL)
+        return FAILURE;
+
+    (void) memset(&hdr, '\0', sizeof hdr);
+    (void) memcpy(hdr.magic, CRS_MAGIC, sizeof hdr.magic);
+    hdr.version = PVW_CRS_VERSION;
+    hdr.nlimbs = nlimbs;
+    hdr.qbits = mpz_sizeinbase(p->q, 2);
+    hdr.window = FBTABLE_WINDOW;
+
+    if (fwrite(&hdr, sizeof hdr, 1, f) != 1
+        || write_number(f, p->p, nlimbs) == FAILURE
+        || write_number(f, p->q, nlimbs) == FAILURE
+        || write_number(f, crs->g0, nlimbs) == FAILURE
+        || write_number(f, crs->h0, nlimbs) == FAILURE
+        || write_number(f, crs->g1, nlimbs) == FAILURE
+        || write_number(f, crs->h1, nlimbs) == FAILURE
+        || write_table(f, &crs->g0tab, nlimbs) == FAILURE
+        || write_table(f, &crs->h0tab, nlimbs) == FAILURE
+        || write_table(f, &crs->g1tab, nlimbs) == FAILURE
+        || write_table(f, &crs->h1tab, nlimbs) == FAILURE)
+        err = 1;
+    if (fclose(f) != 0)
+        err = 1;
+    if (!err && rename(tmp, path) == -1)
+        err = 1;
+    if (err)
+        (void) unlink(tmp);
+    return err ? FAILURE : SUCCESS;
+}
+
+/*
+ * Checks the mapped elements, and entry 1 of their tables, against the ones
+ * hash_to_subgroup() derives, so that a tampered cache file cannot plant a
+ * CRS with a known trapdoor.
+ */
+static int
+check_cache(const struct pvw_crs *crs, const struct params *p)
+{
+    const mpz_t *elems[4] = { &crs->g0, &crs->h0, &crs->g1, &crs->h1 };
+    const struct fbtable *tabs[4] = {
+        &crs->g0tab, &crs->h0tab, &crs->g1tab, &crs->h1tab
+    };
+    mpz_t g;
+    int ok = 1;
+
+    mpz_init(g);
+    for (uint32_t i = 0; ok && i < 4; ++i) {
+        ok = hash_to_subgroup(g, p, i) == SUCCESS
+            && mpz_cmp(g, *elems[i]) == 0
+            && mpz_cmp(g, tabs[i]->table[1]) == 0;
+    }
+    mpz_clear(g);
+    return ok ? SUCCESS : FAILURE;
+}
+
+/*
+ * Maps the CRS from 'path', checking that it was built by this version for the
+ * same group and holds the derived elements.
+ */
+static int
+map_cache(struct pvw_crs *crs, const struct params *p, const char *path)
+{
+    const struct crs_header *hdr;
+    const size_t nlimbs = mpz_size(p->p);
+    const unsigned int qbits = mpz_sizeinbase(p->q, 2);
+    const size_t entries = table_entries(qbits);
+    const mp_limb_t *limbs;
+    struct stat sb;
+    mpz_t x;
+    void *map;
+    int fd, ok;
+
+    if ((fd = open(path, O_RDONLY)) == -1)
+        return FAILURE;
+    if (fstat(fd, &sb) == -1
+        || (size_t) sb.st_size != cache_length(nlimbs, qbits)) {
+        (void) close(fd);
+        return FAILURE;
+    }
+    map = mmap(NULL, sb.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    (void) close(fd);
+    if (map == MAP_FAILED)
+        return FAILURE;
+
+    hdr = (const struct crs_header *) map;
+    limbs = (const mp_limb_t *) (hdr + 1);
+    ok = memcmp(hdr->magic, CRS_MAGIC, sizeof hdr->magic) == 0
+        && hdr->version == PVW_CRS_VERSION
+        && hdr->nlimbs == nlimbs
+        && hdr->qbits == qbits
+        && hdr->window == FBTABLE_WINDOW;
+    ok = ok && mpz_cmp(p->p, mpz_roinit_n(x, limbs, nlimbs)) == 0;
+    ok = ok && mpz_cmp(p->q, mpz_roinit_n(x, limbs + nlimbs, nlimbs)) == 0;
+    if (!ok) {
+        (void) munmap(map, sb.st_size);
+        return FAILURE;
+    }
+    limbs += 2 * nlimbs;
+
+    crs->map = map;
+    crs->maplen = sb.st_size;
+    crs->ready = 1;
+    (void) mpz_roinit_n(crs->g0, limbs, nlimbs);
+    (void) mpz_roinit_n(crs->h0, limbs + nlimbs, nlimbs);
+    (void) mpz_roinit_n(crs->g1, limbs + 2 * nlimbs, nlimbs);
+    (void) mpz_roinit_n(crs->h1, limbs + 3 * nlimbs, nlimbs);
+    limbs += 4 * nlimbs;
+    if (fbtable_map(&crs->g0tab, limbs, nlimbs, qbits) == FAILURE
+        || fbtable_map(&crs->h0tab, limbs + entries * nlimbs, nlimbs,
+                       qbits) == FAILURE
+        || fbtable_map(&crs->g1tab, limbs + 2 * entries * nlimbs, nlimbs,
+                       qbits) == FAILURE
+        || fbtable_map(&crs->h1tab, limbs + 3 * entries * nlimbs, nlimbs,
+                       qbits) == FAILURE)
+        return FAILURE;
+    return check_cache(crs, p);
+}
+
+int
+pvw_crs_init(struct pvw_crs *crs, const struct params *p)
+{
+    const char *path = getenv(PVW_CRS_ENV);
+
+    (void) memset(crs, '\0', sizeof *crs);
+    if (path == NULL || path[0] == '\0')
+        return SUCCESS;
+
+    if (map_cache(crs, p, path) == SUCCESS)
+        return SUCCESS;
+    pvw_crs_cleanup(crs);
+    (void) fprintf(stderr, "Computing PVW CRS for %s\n", path);
+
+    if (crs_compute(crs, p) == FAILURE)
+        return FAILURE;
+    if (write_cache(crs, p, path) == FAILURE)
+        (void) fprintf(stderr, "Error writing PVW CRS to %s\n", path);
+    return SUCCESS;
+}
+
+int
+pvw_crs_ready(struct pvw_crs *crs, const struct params *p)
+{
+    if (crs->ready)
+        return SUCCESS;
+    return crs_compute(crs, p);
+}
+
+void
+pvw_crs_cleanup(struct pvw_crs *crs)
+{
+    if (!crs->ready)
+        return;
+    fbtable_clear(&crs->g0tab);
+    fbtable_clear(&crs->h0tab);
+    fbtable_clear(&crs->g1tab);
+    fbtable_clear(&crs->h1tab);
+    if (crs->map) {
+        (void) munmap(crs->map, crs->maplen);
+    } else {
+        mpz_clears(crs->g0, crs->h0, crs->g1, crs->h1, NULL);
+    }
+    (void) memset(crs, '\0', sizeof *crs);
+}
@@ -0,0 +1,57 @@
+#ifndef __OTLIB_PVW_CRS_H__
+#define __OTLIB_PVW_CRS_H__
+
+#include <gmp.h>
+
+#include "gmputils.h"
+
+/*
+ * Common reference string of the PVW dual-mode cryptosystem in messy mode,
+ * together with fixed-base tables for its four elements.  Messy mode
+ * statistically hides the sender's unchosen message; the receiver's choice is
+ * hidden under DDH as long as nobody knows the discrete logarithms between
+ * the elements.
+ *
+ * The four elements are hashed into the order-q subgroup from fixed public
+ * labels, so both parties derive the same CRS and nobody, its designers
+ * included, knows a trapdoor for it.  Decryption mode needs such a trapdoor
+ * and is therefore not provided.  The CRS is derived once and kept for the
+ * lifetime of the state.  If the environment variable PVW_CRS_ENV names a
+ * file, the CRS and its tables are memory-mapped from that file at state
+ * initialization, creating the file first if it is missing, stale or does
+ * not hold the derived elements.
+ */
+#define PVW_CRS_ENV "OTLIB_PVW_CRS"
+#define PVW_CRS_VERSION 2
+
+struct pvw_crs {
+    int ready;
+    mpz_t g0;
+    mpz_t h0;
+    mpz_t g1;
+    mpz_t h1;
+    struct fbtable g0tab;
+    struct fbtable h0tab;
+    struct fbtable g1tab;
+    struct fbtable h1tab;
+    void *map;                  /* mapped cache file, if any */
+    size_t maplen;
+};
+
+/*
+ * Prepares 'crs', loading it from the cache file if one is configured.
+ * Without a cache file the CRS is only computed on first use.
+ */
+int
+pvw_crs_init(struct pvw_crs *crs, const struct params *p);
+
+/*
+ * Makes sure 'crs' has been computed or loaded.
+ */
+int
+pvw_crs_ready(struct pvw_crs *crs, const struct params *p);
+
+void
+pvw_crs_cleanup(struct pvw_crs *crs);
+
+#endif
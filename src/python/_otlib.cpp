@@ -1,38 +1,80 @@
 #include <Python.h>
 
+#include "py_otext.h"
 #include "py_otext_iknp.h"
-#include "../otext_nnob.h"
+#include "py_otext_kk.h"
+#include "py_otext_nnob.h"
+#include "py_ot_co.h"
 #include "py_ot_np.h"
-#include "../ot_pvw.h"
+#include "py_ot_pvw.h"
 #include "py_state.h"
 
+#include "../otext_iknp.h"
+
 static PyMethodDef
 methods[] = {
     {"init", py_state_init, METH_VARARGS, "initialize OT state."},
     {"cleanup", py_state_cleanup, METH_VARARGS, "cleanup OT state."},
+    {"random_bytes", py_state_random_bytes, METH_VARARGS,
+     "random bytes from the state's generator."},
     {"ot_np_send", py_ot_np_send, METH_VARARGS,
      "sender operation for Naor-Pinkas OT."},
     {"ot_np_receive", py_ot_np_recv, METH_VARARGS,
      "receiver operation for Naor-Pinkas OT."},
-    // {"ot_pvw_send", ot_pvw_send, METH_VARARGS,
-    //  "sender operation for PVW OT."},
-    // {"ot_pvw_receive", ot_pvw_receive, METH_VARARGS,
-    //  "receiver operation for PVW OT."},
+    {"ot_co_send", py_ot_co_send, METH_VARARGS,
+     "sender operation for Chou-Orlandi OT."},
+    {"ot_co_receive", py_ot_co_recv, METH_VARARGS,
+     "receiver operation for Chou-Orlandi OT."},
+    {"ot_pvw_send", py_ot_pvw_send, METH_VARARGS,
+     "sender operation for PVW OT."},
+    {"ot_pvw_receive", py_ot_pvw_recv, METH_VARARGS,
+     "receiver operation for PVW OT."},
+    {"otext_expand_send", py_otext_expand_send, METH_VARARGS,
+     "sender expansion of base OT seeds for OT extension."},
+    {"otext_expand_receive", py_otext_expand_recv, METH_VARARGS,
+     "receiver expansion of base OT seeds for OT extension."},
     {"otext_iknp_send", py_otext_iknp_send, METH_VARARGS,
      "sender operation for IKNP OT extension."},
-    {"otext_iknp_matrix_xor", otext_iknp_matrix_xor, METH_VARARGS,
-     "matrix XOR operation for IKNP OT extension."},
     {"otext_iknp_receive", py_otext_iknp_recv, METH_VARARGS,
      "receiver operation for IKNP OT extension."},
-    // {"otext_nnob_send", otext_nnob_send, METH_VARARGS,
-    //  "sender operation for NNOB OT extension."},
-    // {"otext_nnob_receive", otext_nnob_receive, METH_VARARGS,
-    //  "receiver operation for NNOB OT extension."},
+    {"otext_iknp_send_random", py_otext_iknp_send_random, METH_VARARGS,
+     "sender operation for IKNP random OT extension."},
+    {"otext_iknp_receive_random", py_otext_iknp_recv_random, METH_VARARGS,
+     "receiver operation for IKNP random OT extension."},
+    {"otext_iknp_send_correlated", py_otext_iknp_send_correlated,
+     METH_VARARGS, "sender operation for IKNP correlated OT extension."},
+    {"otext_iknp_receive_correlated", py_otext_iknp_recv_correlated,
+     METH_VARARGS, "receiver operation for IKNP correlated OT extension."},
+    {"otext_iknp_derandomize_send", py_otext_iknp_derandomize_send,
+     METH_VARARGS, "sender derandomization of IKNP random OTs."},
+    {"otext_iknp_derandomize_receive", py_otext_iknp_derandomize_recv,
+     METH_VARARGS, "receiver derandomization of IKNP random OTs."},
+    {"otext_kos_send", py_otext_kos_send, METH_VARARGS,
+     "sender operation for KOS malicious OT extension."},
+    {"otext_kos_receive", py_otext_kos_recv, METH_VARARGS,
+     "receiver operation for KOS malicious OT extension."},
+    {"otext_kk_send", py_otext_kk_send, METH_VARARGS,
+     "sender operation for KK 1-out-of-N OT extension."},
+    {"otext_kk_codewords", py_otext_kk_codewords, METH_VARARGS,
+     "codeword matrix for KK OT extension."},
+    {"otext_kk_receive", py_otext_kk_recv, METH_VARARGS,
+     "receiver operation for KK 1-out-of-N OT extension."},
+    {"otext_nnob_ncols", py_otext_nnob_ncols, METH_VARARGS,
+     "number of base OTs for NNOB OT extension."},
+    {"otext_nnob_send", py_otext_nnob_send, METH_VARARGS,
+     "sender operation for NNOB OT extension."},
+    {"otext_nnob_receive", py_otext_nnob_recv, METH_VARARGS,
+     "receiver operation for NNOB OT extension."},
     {NULL, NULL, 0, NULL}
 };
 
 PyMODINIT_FUNC
 init_otlib(void)
 {
-    (void) Py_InitModule("_otlib", methods);
+    PyObject *m;
+
+    m = Py_InitModule("_otlib", methods);
+    if (m == NULL)
+        return;
+    (void) PyModule_AddIntConstant(m, "OTEXT_KOS_PAD", OTEXT_KOS_PAD);
 }
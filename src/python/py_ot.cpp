@@ -1,32 +1,239 @@
-#include <Python.h>
-
 #include "py_ot.h"
 
-void *
-py_ot_msg_reader(void *msgs, int idx)
+#include "../ot.h"
+#include "../utils.h"
+
+#include <string.h>
+
+unsigned char *
+py_ot_pack_msgs(PyObject *py_msgs, long nmsgs, int N, size_t maxlength)
 {
-    return (void *) PySequence_GetItem((PyObject *) msgs, idx);
+    unsigned char *msgs;
+
+    msgs = (unsigned char *) ot_malloc(nmsgs * N * maxlength);
+    if (msgs == NULL) {
+        (void) PyErr_NoMemory();
+        return NULL;
+    }
+    (void) memset(msgs, '\0', nmsgs * N * maxlength);
+
+    for (long j = 0; j < nmsgs; ++j) {
+        PyObject *tuple = PySequence_GetItem(py_msgs, j);
+
+        if (tuple == NULL)
+            goto error;
+        if (PySequence_Length(tuple) != N) {
+            Py_DECREF(tuple);
+            PyErr_SetString(PyExc_TypeError, "unmatched input length");
+            goto error;
+        }
+        for (int i = 0; i < N; ++i) {
+            PyObject *item = PySequence_GetItem(tuple, i);
+            char *m;
+            Py_ssize_t mlen;
+
+            if (item == NULL || PyBytes_AsStringAndSize(item, &m, &mlen) == -1) {
+                Py_XDECREF(item);
+                Py_DECREF(tuple);
+                goto error;
+            }
+            if ((size_t) mlen > maxlength) {
+                Py_DECREF(item);
+                Py_DECREF(tuple);
+                PyErr_SetString(PyExc_TypeError, "message > msglength");
+                goto error;
+            }
+            (void) memcpy(msgs + (j * N + i) * maxlength, m, mlen);
+            Py_DECREF(item);
+        }
+        Py_DECREF(tuple);
+    }
+    return msgs;
+
+ error:
+    ot_free(msgs);
+    return NULL;
 }
 
-void
-py_ot_item_reader(void *item, int idx, void *m, ssize_t *mlen)
+unsigned char *
+py_ot_pack_strings(PyObject *py_strs, long nstrs, size_t maxlength)
 {
-    (void) PyBytes_AsStringAndSize(PySequence_GetItem((PyObject *) item, idx),
-                                   (char **) m, mlen);
+    unsigned char *buf;
+
+    buf = (unsigned char *) ot_malloc(nstrs * maxlength);
+    if (buf == NULL) {
+        (void) PyErr_NoMemory();
+        return NULL;
+    }
+    (void) memset(buf, '\0', nstrs * maxlength);
+
+    for (long j = 0; j < nstrs; ++j) {
+        PyObject *item = PySequence_GetItem(py_strs, j);
+        char *m;
+        Py_ssize_t mlen;
+
+        if (item == NULL || PyBytes_AsStringAndSize(item, &m, &mlen) == -1) {
+            Py_XDECREF(item);
+            goto error;
+        }
+        if ((size_t) mlen > maxlength) {
+            Py_DECREF(item);
+            PyErr_SetString(PyExc_TypeError, "message > msglength");
+            goto error;
+        }
+        (void) memcpy(buf + j * maxlength, m, mlen);
+        Py_DECREF(item);
+    }
+    return buf;
+
+ error:
+    ot_free(buf);
+    return NULL;
 }
 
-int
-py_ot_choice_reader(void *choices, int idx)
+static int
+read_choice(PyObject *py_choices, long idx, long *choice)
 {
-    return PyLong_AsLong(PySequence_GetItem((PyObject *) choices, idx));
+    PyObject *item = PySequence_GetItem(py_choices, idx);
+
+    if (item == NULL)
+        return -1;
+    *choice = PyLong_AsLong(item);
+    Py_DECREF(item);
+    if (*choice == -1 && PyErr_Occurred())
+        return -1;
+    return 0;
 }
 
-int
-py_ot_msg_writer(void *out, int idx, void *msg, size_t maxlength)
+unsigned char *
+py_ot_pack_choice_bits(PyObject *py_choices, long nchoices)
 {
-    PyObject *str = PyString_FromStringAndSize((char *) msg, maxlength);
-    if (str == NULL)
-        return 1;
-    PyTuple_SetItem((PyObject *) out, idx, str);
-    return 0;
+    unsigned char *choices;
+
+    choices = (unsigned char *) ot_malloc((nchoices + 7) / 8);
+    if (choices == NULL) {
+        (void) PyErr_NoMemory();
+        return NULL;
+    }
+    (void) memset(choices, '\0', (nchoices + 7) / 8);
+
+    for (long j = 0; j < nchoices; ++j) {
+        long choice;
+
+        if (read_choice(py_choices, j, &choice) == -1) {
+            ot_free(choices);
+            return NULL;
+        }
+        ot_set_choice(choices, j, choice != 0);
+    }
+    return choices;
+}
+
+unsigned char *
+py_ot_pack_choice_bytes(PyObject *py_choices, long nchoices, int N)
+{
+    unsigned char *choices;
+
+    choices = (unsigned char *) ot_malloc(nchoices);
+    if (choices == NULL) {
+        (void) PyErr_NoMemory();
+        return NULL;
+    }
+
+    for (long j = 0; j < nchoices; ++j) {
+        long choice;
+
+        if (read_choice(py_choices, j, &choice) == -1) {
+            ot_free(choices);
+            return NULL;
+        }
+        if (choice < 0 || choice >= N) {
+            ot_free(choices);
+            PyErr_SetString(PyExc_ValueError, "choice out of range");
+            return NULL;
+        }
+        choices[j] = (unsigned char) choice;
+    }
+    return choices;
+}
+
+/*
+ * Concatenates 'ncols' strings of 'nrows' bits each into one buffer.
+ */
+unsigned char *
+py_ot_pack_columns(PyObject *py_cols, int ncols, long nrows)
+{
+    unsigned char *array;
+
+    array = (unsigned char *) ot_malloc(ncols * nrows / 8);
+    if (array == NULL) {
+        (void) PyErr_NoMemory();
+        return NULL;
+    }
+
+    for (int i = 0; i < ncols; ++i) {
+        PyObject *py_col = PySequence_GetItem(py_cols, i);
+        char *col;
+        Py_ssize_t collen;
+
+        if (py_col == NULL
+            || PyBytes_AsStringAndSize(py_col, &col, &collen) == -1) {
+            Py_XDECREF(py_col);
+            ot_free(array);
+            return NULL;
+        }
+        if (collen * 8 != nrows) {
+            Py_DECREF(py_col);
+            ot_free(array);
+            PyErr_SetString(PyExc_ValueError, "column length mismatch");
+            return NULL;
+        }
+        (void) memcpy(array + i * collen, col, collen);
+        Py_DECREF(py_col);
+    }
+    return array;
+}
+
+PyObject *
+py_ot_unpack_msgs(const unsigned char *out, long nmsgs, size_t maxlength)
+{
+    PyObject *py_out;
+
+    py_out = PyTuple_New(nmsgs);
+    if (py_out == NULL)
+        return NULL;
+    for (long j = 0; j < nmsgs; ++j) {
+        PyObject *str;
+
+        str = PyString_FromStringAndSize((char *) out + j * maxlength,
+                                         maxlength);
+        if (str == NULL) {
+            Py_DECREF(py_out);
+            return NULL;
+        }
+        PyTuple_SET_ITEM(py_out, j, str);
+    }
+    return py_out;
+}
+
+PyObject *
+py_ot_unpack_tuples(const unsigned char *out, long nmsgs, int N,
+                    size_t maxlength)
+{
+    PyObject *py_out;
+
+    py_out = PyTuple_New(nmsgs);
+    if (py_out == NULL)
+        return NULL;
+    for (long j = 0; j < nmsgs; ++j) {
+        PyObject *tuple;
+
+        tuple = py_ot_unpack_msgs(out + j * N * maxlength, N, maxlength);
+        if (tuple == NULL) {
+            Py_DECREF(py_out);
+            return NULL;
+        }
+        PyTuple_SET_ITEM(py_out, j, tuple);
+    }
+    return py_out;
 }
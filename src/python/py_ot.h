@@ -1,18 +1,41 @@
 #ifndef __OTLIB_PY_OT_H__
 #define __OTLIB_PY_OT_H__
 
-#include <unistd.h>
+#include <Python.h>
 
-void *
-py_ot_msg_reader(void *msgs, int idx);
+/*
+ * Adapters between Python sequences and the contiguous buffers used by the
+ * native OT APIs (see ot.h).  The pack functions return a buffer allocated
+ * with ot_malloc, or NULL with a Python exception set.
+ */
 
-void
-py_ot_item_reader(void *item, int idx, void *m, ssize_t *mlen);
+unsigned char *
+py_ot_pack_msgs(PyObject *py_msgs, long nmsgs, int N, size_t maxlength);
 
-int
-py_ot_choice_reader(void *choices, int idx);
+/*
+ * Packs a sequence of 'nstrs' strings, each zero-padded to 'maxlength' bytes.
+ */
+unsigned char *
+py_ot_pack_strings(PyObject *py_strs, long nstrs, size_t maxlength);
 
-int
-py_ot_msg_writer(void *out, int idx, void *msg, size_t maxlength);
+unsigned char *
+py_ot_pack_choice_bits(PyObject *py_choices, long nchoices);
+
+unsigned char *
+py_ot_pack_choice_bytes(PyObject *py_choices, long nchoices, int N);
+
+unsigned char *
+py_ot_pack_columns(PyObject *py_cols, int ncols, long nrows);
+
+PyObject *
+py_ot_unpack_msgs(const unsigned char *out, long nmsgs, size_t maxlength);
+
+/*
+ * Returns a tuple of 'nmsgs' N-tuples of messages laid out as in
+ * py_ot_pack_msgs().
+ */
+PyObject *
+py_ot_unpack_tuples(const unsigned char *out, long nmsgs, int N,
+                    size_t maxlength);
 
 #endif
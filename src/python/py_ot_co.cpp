@@ -0,0 +1,109 @@
+#include "py_ot_co.h"
+#include "py_ot.h"
+
+#include "../ot_co.h"
+#include "../utils.h"
+
+static int
+check_group(int type)
+{
+    if (type < 0 || type >= GROUP_NTYPES) {
+        PyErr_SetString(PyExc_ValueError, "unknown group");
+        return FAILURE;
+    }
+    return SUCCESS;
+}
+
+PyObject *
+py_ot_co_send(PyObject *self, PyObject *args)
+{
+    PyObject *py_state, *py_msgs, *py_item;
+    long N, num_ots, err = 0;
+    int msglength, type = GROUP_EC;
+    unsigned char *msgs;
+    struct state *st;
+
+    if (!PyArg_ParseTuple(args, "OOi|i", &py_state, &py_msgs, &msglength,
+                          &type))
+        return NULL;
+
+    st = (struct state *) PyCapsule_GetPointer(py_state, NULL);
+    if (st == NULL)
+        return NULL;
+    if (check_group(type) == FAILURE)
+        return NULL;
+
+    if ((num_ots = PySequence_Length(py_msgs)) == -1)
+        return NULL;
+
+    if ((py_item = PySequence_GetItem(py_msgs, 0)) == NULL)
+        return NULL;
+    N = PySequence_Length(py_item);
+    Py_DECREF(py_item);
+    if (N == -1)
+        return NULL;
+
+    msgs = py_ot_pack_msgs(py_msgs, num_ots, N, msglength);
+    if (msgs == NULL)
+        return NULL;
+
+    err = ot_co_send(st, (enum group_type) type, msgs, msglength, num_ots, N);
+
+    ot_free(msgs);
+
+    if (err) {
+        PyErr_SetString(PyExc_RuntimeError, "OT send failed");
+        return NULL;
+    } else {
+        Py_RETURN_NONE;
+    }
+}
+
+PyObject *
+py_ot_co_recv(PyObject *self, PyObject *args)
+{
+    PyObject *state, *py_choices, *py_out = NULL;
+    struct state *st;
+    unsigned char *choices = NULL, *out = NULL;
+    int nchoices, err = 0;
+    int N, maxlength, type = GROUP_EC;
+
+    if (!PyArg_ParseTuple(args, "OOii|i", &state, &py_choices, &N, &maxlength,
+                          &type))
+        return NULL;
+
+    st = (struct state *) PyCapsule_GetPointer(state, NULL);
+    if (st == NULL)
+        return NULL;
+    if (check_group(type) == FAILURE)
+        return NULL;
+
+    if ((nchoices = PySequence_Length(py_choices)) == -1)
+        return NULL;
+    if (N < 1) {
+        PyErr_SetString(PyExc_ValueError, "N must be at least 1");
+        return NULL;
+    }
+
+    choices = py_ot_pack_choice_bytes(py_choices, nchoices, N);
+    if (choices == NULL)
+        return NULL;
+    out = (unsigned char *) ot_malloc((long) nchoices * maxlength);
+    if (out == NULL) {
+        ot_free(choices);
+        return PyErr_NoMemory();
+    }
+
+    err = ot_co_recv(st, (enum group_type) type, choices, nchoices, maxlength,
+                     N, out);
+
+    if (err)
+        PyErr_SetString(PyExc_RuntimeError, "OT receive failed");
+    else
+        py_out = py_ot_unpack_msgs(out, nchoices, maxlength);
+
+    ot_free(choices);
+    ot_free(out);
+
+    return py_out;
+}
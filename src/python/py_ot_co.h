@@ -0,0 +1,12 @@
+#ifndef __OTLIB_PY_OT_CO_H__
+#define __OTLIB_PY_OT_CO_H__
+
+#include <Python.h>
+
+PyObject *
+py_ot_co_send(PyObject *self, PyObject *args);
+
+PyObject *
+py_ot_co_recv(PyObject *self, PyObject *args);
+
+#endif
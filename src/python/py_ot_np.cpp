@@ -2,19 +2,15 @@
 #include "py_ot.h"
 
 #include "../ot_np.h"
-#include "../crypto.h"
-#include <arpa/inet.h>
-#include <sys/types.h>
-#include <sys/socket.h>
-
-#define ERROR { err = 1; goto cleanup; }
+#include "../utils.h"
 
 PyObject *
 py_ot_np_send(PyObject *self, PyObject *args)
 {
-    PyObject *py_state, *py_msgs;
+    PyObject *py_state, *py_msgs, *py_item;
     long N, num_ots, err = 0;
     int msglength;
+    unsigned char *msgs;
     struct state *st;
 
     if (!PyArg_ParseTuple(args, "OOi", &py_state, &py_msgs, &msglength))
@@ -27,61 +23,68 @@ py_ot_np_send(PyObject *self, PyObject *args)
     if ((num_ots = PySequence_Length(py_msgs)) == -1)
         return NULL;
 
-    if ((N = PySequence_Length(PySequence_GetItem(py_msgs, 0))) == -1)
+    if ((py_item = PySequence_GetItem(py_msgs, 0)) == NULL)
+        return NULL;
+    N = PySequence_Length(py_item);
+    Py_DECREF(py_item);
+    if (N == -1)
         return NULL;
 
-    /* check to make sure all OTs are 1-out-of-N OTs and all messages are of
-       length <= msglength */
-    for (int j = 0; j < num_ots; ++j) {
-        PyObject *tuple = PySequence_GetItem(py_msgs, j);
-        if (PySequence_Length(tuple) != N) {
-            PyErr_SetString(PyExc_TypeError, "unmatched input length");
-            return NULL;
-        }
-        for (int i = 0; i < N; ++i) {
-            if (PyString_Size(PySequence_GetItem(tuple, i)) > msglength) {
-                PyErr_SetString(PyExc_TypeError, "message > msglength");
-                return NULL;
-            }
-        }
-    }
+    /* checks that all OTs are 1-out-of-N OTs and all messages are of length
+       <= msglength */
+    msgs = py_ot_pack_msgs(py_msgs, num_ots, N, msglength);
+    if (msgs == NULL)
+        return NULL;
 
-    err = ot_np_send(st, py_msgs, msglength, num_ots, N, py_ot_msg_reader,
-                     py_ot_item_reader);
+    err = ot_np_send(st, msgs, msglength, num_ots, N);
 
-    if (err)
+    ot_free(msgs);
+
+    if (err) {
+        PyErr_SetString(PyExc_RuntimeError, "OT send failed");
         return NULL;
-    else
+    } else {
         Py_RETURN_NONE;
+    }
 }
 
 PyObject *
 py_ot_np_recv(PyObject *self, PyObject *args)
 {
-    PyObject *state, *choices, *out = NULL;
+    PyObject *state, *py_choices, *py_out = NULL;
     struct state *st;
+    unsigned char *choices = NULL, *out = NULL;
     int nchoices, err = 0;
     int N, maxlength;
 
-    if (!PyArg_ParseTuple(args, "OOii", &state, &choices, &N, &maxlength))
+    if (!PyArg_ParseTuple(args, "OOii", &state, &py_choices, &N, &maxlength))
         return NULL;
 
     st = (struct state *) PyCapsule_GetPointer(state, NULL);
     if (st == NULL)
         return NULL;
 
-    if ((nchoices = PySequence_Length(choices)) == -1)
+    if ((nchoices = PySequence_Length(py_choices)) == -1)
         return NULL;
 
-    out = PyTuple_New(nchoices);
-    
-    err = ot_np_recv(st, choices, nchoices, maxlength, N, out,
-                     py_ot_choice_reader, py_ot_msg_writer);
+    choices = py_ot_pack_choice_bytes(py_choices, nchoices, N);
+    if (choices == NULL)
+        return NULL;
+    out = (unsigned char *) ot_malloc((long) nchoices * maxlength);
+    if (out == NULL) {
+        ot_free(choices);
+        return PyErr_NoMemory();
+    }
 
-    // TODO: cleanup out on error
+    err = ot_np_recv(st, choices, nchoices, maxlength, N, out);
 
     if (err)
-        return NULL;
+        PyErr_SetString(PyExc_RuntimeError, "OT receive failed");
     else
-        return out;
+        py_out = py_ot_unpack_msgs(out, nchoices, maxlength);
+
+    ot_free(choices);
+    ot_free(out);
+
+    return py_out;
 }
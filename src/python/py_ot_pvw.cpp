@@ -0,0 +1,98 @@
+#include "py_ot_pvw.h"
+#include "py_ot.h"
+
+#include "../ot_pvw.h"
+#include "../utils.h"
+
+PyObject *
+py_ot_pvw_send(PyObject *self, PyObject *args)
+{
+    PyObject *py_state, *py_msgs, *py_item;
+    long N, num_ots, err = 0;
+    int msglength;
+    unsigned char *msgs;
+    struct state *st;
+
+    if (!PyArg_ParseTuple(args, "OOi", &py_state, &py_msgs, &msglength))
+        return NULL;
+
+    st = (struct state *) PyCapsule_GetPointer(py_state, NULL);
+    if (st == NULL)
+        return NULL;
+
+    if ((num_ots = PySequence_Length(py_msgs)) == -1)
+        return NULL;
+
+    if ((py_item = PySequence_GetItem(py_msgs, 0)) == NULL)
+        return NULL;
+    N = PySequence_Length(py_item);
+    Py_DECREF(py_item);
+    if (N == -1)
+        return NULL;
+    if (N != 2) {
+        PyErr_SetString(PyExc_ValueError, "N must be 2");
+        return NULL;
+    }
+
+    /* checks that all OTs are 1-out-of-N OTs and all messages are of length
+       <= msglength */
+    msgs = py_ot_pack_msgs(py_msgs, num_ots, N, msglength);
+    if (msgs == NULL)
+        return NULL;
+
+    err = ot_pvw_send(st, msgs, msglength, num_ots, N);
+
+    ot_free(msgs);
+
+    if (err) {
+        PyErr_SetString(PyExc_RuntimeError, "OT send failed");
+        return NULL;
+    } else {
+        Py_RETURN_NONE;
+    }
+}
+
+PyObject *
+py_ot_pvw_recv(PyObject *self, PyObject *args)
+{
+    PyObject *state, *py_choices, *py_out = NULL;
+    struct state *st;
+    unsigned char *choices = NULL, *out = NULL;
+    int nchoices, err = 0;
+    int N, maxlength;
+
+    if (!PyArg_ParseTuple(args, "OOii", &state, &py_choices, &N, &maxlength))
+        return NULL;
+
+    st = (struct state *) PyCapsule_GetPointer(state, NULL);
+    if (st == NULL)
+        return NULL;
+
+    if ((nchoices = PySequence_Length(py_choices)) == -1)
+        return NULL;
+    if (N != 2) {
+        PyErr_SetString(PyExc_ValueError, "N must be 2");
+        return NULL;
+    }
+
+    choices = py_ot_pack_choice_bytes(py_choices, nchoices, N);
+    if (choices == NULL)
+        return NULL;
+    out = (unsigned char *) ot_malloc((long) nchoices * maxlength);
+    if (out == NULL) {
+        ot_free(choices);
+        return PyErr_NoMemory();
+    }
+
+    err = ot_pvw_recv(st, choices, nchoices, maxlength, N, out);
+
+    if (err)
+        PyErr_SetString(PyExc_RuntimeError, "OT receive failed");
+    else
+        py_out = py_ot_unpack_msgs(out, nchoices, maxlength);
+
+    ot_free(choices);
+    ot_free(out);
+
+    return py_out;
+}
@@ -0,0 +1,12 @@
+#ifndef __OTLIB_PY_OT_PVW_H__
+#define __OTLIB_PY_OT_PVW_H__
+
+#include <Python.h>
+
+PyObject *
+py_ot_pvw_send(PyObject *self, PyObject *args);
+
+PyObject *
+py_ot_pvw_recv(PyObject *self, PyObject *args);
+
+#endif
@@ -0,0 +1,107 @@
+#include "py_otext.h"
+#include "py_ot.h"
+
+#include "../otext.h"
+#include "../utils.h"
+
+PyObject *
+py_otext_expand_send(PyObject *self, PyObject *args)
+{
+    PyObject *py_state, *py_seeds, *py_return = NULL;
+    struct state *st;
+    unsigned char *seeds = NULL, *qcols = NULL;
+    char *s;
+    int slen;
+    unsigned int ncols;
+    long nrows;
+
+    if (!PyArg_ParseTuple(args, "OOs#Il", &py_state, &py_seeds, &s, &slen,
+                          &ncols, &nrows))
+        return NULL;
+
+    st = (struct state *) PyCapsule_GetPointer(py_state, NULL);
+    if (st == NULL)
+        return NULL;
+
+    if ((unsigned int) slen != ncols / 8) {
+        PyErr_SetString(PyExc_ValueError, "len(s) != ncols / 8");
+        return NULL;
+    }
+
+    seeds = py_ot_pack_strings(py_seeds, ncols, OTEXT_SEEDLEN);
+    if (seeds == NULL)
+        goto cleanup;
+    qcols = (unsigned char *) ot_malloc(ncols * (nrows / 8));
+    if (qcols == NULL) {
+        (void) PyErr_NoMemory();
+        goto cleanup;
+    }
+
+    if (otext_expand_send(st, seeds, (unsigned char *) s, ncols, nrows, qcols))
+        PyErr_SetString(PyExc_RuntimeError, "seed expansion failed");
+    else
+        py_return = py_ot_unpack_msgs(qcols, ncols, nrows / 8);
+
+ cleanup:
+    if (seeds)
+        ot_free(seeds);
+    if (qcols)
+        ot_free(qcols);
+
+    return py_return;
+}
+
+PyObject *
+py_otext_expand_recv(PyObject *self, PyObject *args)
+{
+    PyObject *py_state, *py_seeds, *py_return = NULL;
+    struct state *st;
+    unsigned char *seeds = NULL, *tcols = NULL;
+    char *x;
+    int xlen;
+    unsigned int ncols;
+    long nrows;
+    size_t xstride;
+
+    if (!PyArg_ParseTuple(args, "OOs#Il", &py_state, &py_seeds, &x, &xlen,
+                          &ncols, &nrows))
+        return NULL;
+
+    st = (struct state *) PyCapsule_GetPointer(py_state, NULL);
+    if (st == NULL)
+        return NULL;
+
+    /* x is either one column shared by all, or one column per base OT */
+    if (xlen == nrows / 8) {
+        xstride = 0;
+    } else if (xlen == ncols * (nrows / 8)) {
+        xstride = nrows / 8;
+    } else {
+        PyErr_SetString(PyExc_ValueError, "len(x) must be nrows / 8 or "
+                        "ncols * nrows / 8");
+        return NULL;
+    }
+
+    seeds = py_ot_pack_msgs(py_seeds, ncols, 2, OTEXT_SEEDLEN);
+    if (seeds == NULL)
+        goto cleanup;
+    tcols = (unsigned char *) ot_malloc(ncols * (nrows / 8));
+    if (tcols == NULL) {
+        (void) PyErr_NoMemory();
+        goto cleanup;
+    }
+
+    if (otext_expand_recv(st, seeds, (unsigned char *) x, xstride, ncols,
+                          nrows, tcols))
+        PyErr_SetString(PyExc_RuntimeError, "seed expansion failed");
+    else
+        py_return = py_ot_unpack_msgs(tcols, ncols, nrows / 8);
+
+ cleanup:
+    if (seeds)
+        ot_free(seeds);
+    if (tcols)
+        ot_free(tcols);
+
+    return py_return;
+}
@@ -0,0 +1,12 @@
+#ifndef __OTLIB_PY_OTEXT_H__
+#define __OTLIB_PY_OTEXT_H__
+
+#include <Python.h>
+
+PyObject *
+py_otext_expand_send(PyObject *self, PyObject *args);
+
+PyObject *
+py_otext_expand_recv(PyObject *self, PyObject *args);
+
+#endif
@@ -2,136 +2,416 @@
 #include "py_ot.h"
 
 #include "../otext_iknp.h"
-#include "../crypto.h"
 #include "../utils.h"
 
-static unsigned char *
-to_array(PyObject *columns, int nrows, int ncols)
+PyObject *
+py_otext_iknp_send(PyObject *self, PyObject *args)
 {
-    unsigned char *array;
-    double start, end;
+    PyObject *py_state, *py_msgs, *py_qt;
+    struct state *st;
+    long m, err = 0;
+    char *s;
+    unsigned char *msgs = NULL, *qcols = NULL;
+    int slen;
+    unsigned int msglength, secparam;
+
+    if (!PyArg_ParseTuple(args, "OOOs#II", &py_state, &py_msgs,
+                          &py_qt, &s, &slen, &msglength, &secparam))
+        return NULL;
+
+    st = (struct state *) PyCapsule_GetPointer(py_state, NULL);
+    if (st == NULL)
+        return NULL;
 
-    start = current_time();
-    array = (unsigned char *) malloc(nrows * ncols / 8);
-    if (array == NULL)
+    if ((m = PySequence_Length(py_msgs)) == -1)
         return NULL;
-    memset(array, '\0', nrows * ncols / 8);
 
-    for (int i = 0; i < ncols; ++i) {
-        char *col;
-        Py_ssize_t collen;
+    if ((unsigned int) slen != secparam / 8) {
+        PyErr_SetString(PyExc_ValueError, "len(s) != secparam / 8");
+        return NULL;
+    }
 
-        (void) PyBytes_AsStringAndSize(PySequence_GetItem(columns, i),
-                                       &col, &collen);
-        assert(collen * 8 == nrows);
-        memcpy(array + i * collen, col, collen);
+    msgs = py_ot_pack_msgs(py_msgs, m, 2, msglength);
+    if (msgs == NULL) {
+        err = 1;
+        goto cleanup;
+    }
+    qcols = py_ot_pack_columns(py_qt, secparam, m);
+    if (qcols == NULL) {
+        err = 1;
+        goto cleanup;
     }
-    end = current_time();
-    fprintf(stderr, "to_array: %f\n", end - start);
 
-    return array;
+    err = otext_iknp_send(st, msgs, m, msglength, secparam,
+                          (unsigned char *) s, qcols);
+    if (err)
+        PyErr_SetString(PyExc_RuntimeError, "OT extension send failed");
+
+ cleanup:
+    if (msgs)
+        ot_free(msgs);
+    if (qcols)
+        ot_free(qcols);
+
+    if (err)
+        return NULL;
+    else
+        Py_RETURN_NONE;
 }
 
-static const unsigned char MASK_BIT[8] =
-    {0x80, 0x40, 0x20, 0x10, 0x8, 0x4, 0x2, 0x1};
-static const unsigned char CMASK_BIT[8] =
-    {0x7f, 0xbf, 0xdf, 0xef, 0xf7, 0xfb, 0xfd, 0xfe};
-static const unsigned char MASK_SET_BIT_C[2][8] =
-    {{0x80, 0x40, 0x20, 0x10, 0x8, 0x4, 0x2, 0x1},
-     {   0,    0,    0,    0,   0,   0,   0,   0}};
+PyObject *
+py_otext_iknp_recv(PyObject *self, PyObject *args)
+{
+    PyObject *py_state, *py_T, *py_choices, *py_return = NULL;
+    struct state *st;
+    unsigned char *choices = NULL, *tcols = NULL, *out = NULL;
+    long nchoices;
+    unsigned int maxlength, secparam;
 
-static inline unsigned char
-get_bit(const unsigned char *array, int idx)
+    if (!PyArg_ParseTuple(args, "OOOII", &py_state, &py_choices, &py_T,
+                          &maxlength, &secparam))
+        return NULL;
+
+    st = (struct state *) PyCapsule_GetPointer(py_state, NULL);
+    if (st == NULL)
+        return NULL;
+
+    if ((nchoices = PySequence_Length(py_choices)) == -1)
+        return NULL;
+
+    choices = py_ot_pack_choice_bits(py_choices, nchoices);
+    if (choices == NULL)
+        goto cleanup;
+    tcols = py_ot_pack_columns(py_T, secparam, nchoices);
+    if (tcols == NULL)
+        goto cleanup;
+    out = (unsigned char *) ot_malloc(nchoices * maxlength);
+    if (out == NULL) {
+        (void) PyErr_NoMemory();
+        goto cleanup;
+    }
+
+    if (otext_iknp_recv(st, choices, nchoices, maxlength, secparam, tcols,
+                        out))
+        PyErr_SetString(PyExc_RuntimeError, "OT extension receive failed");
+    else
+        py_return = py_ot_unpack_msgs(out, nchoices, maxlength);
+
+ cleanup:
+    if (choices)
+        ot_free(choices);
+    if (tcols)
+        ot_free(tcols);
+    if (out)
+        ot_free(out);
+
+    return py_return;
+}
+
+PyObject *
+py_otext_iknp_send_random(PyObject *self, PyObject *args)
 {
-    return !!(array[idx >> 3] & MASK_BIT[idx & 0x7]);
+    PyObject *py_state, *py_qt, *py_return = NULL;
+    struct state *st;
+    unsigned char *qcols = NULL, *out = NULL;
+    char *s;
+    int slen;
+    long m;
+    unsigned int maxlength, secparam;
+
+    if (!PyArg_ParseTuple(args, "OOs#lII", &py_state, &py_qt, &s, &slen, &m,
+                          &maxlength, &secparam))
+        return NULL;
+
+    st = (struct state *) PyCapsule_GetPointer(py_state, NULL);
+    if (st == NULL)
+        return NULL;
+
+    if ((unsigned int) slen != secparam / 8) {
+        PyErr_SetString(PyExc_ValueError, "len(s) != secparam / 8");
+        return NULL;
+    }
+
+    qcols = py_ot_pack_columns(py_qt, secparam, m);
+    if (qcols == NULL)
+        goto cleanup;
+    out = (unsigned char *) ot_malloc(2 * m * maxlength);
+    if (out == NULL) {
+        (void) PyErr_NoMemory();
+        goto cleanup;
+    }
+
+    if (otext_iknp_send_random(st, m, maxlength, secparam,
+                               (unsigned char *) s, qcols, out))
+        PyErr_SetString(PyExc_RuntimeError, "random OT extension send failed");
+    else
+        py_return = py_ot_unpack_tuples(out, m, 2, maxlength);
+
+ cleanup:
+    if (qcols)
+        ot_free(qcols);
+    if (out)
+        ot_free(out);
+
+    return py_return;
 }
 
-static inline void
-set_bit(unsigned char *array, int idx, unsigned char bit)
+PyObject *
+py_otext_iknp_recv_random(PyObject *self, PyObject *args)
 {
-    array[idx >> 3] = (array[idx >> 3] & CMASK_BIT[idx & 0x7]) | MASK_SET_BIT_C[!bit][idx & 0x7];
+    PyObject *py_state, *py_T, *py_return = NULL;
+    struct state *st;
+    unsigned char *tcols = NULL, *out = NULL;
+    long nchoices;
+    unsigned int maxlength, secparam;
+
+    if (!PyArg_ParseTuple(args, "OOlII", &py_state, &py_T, &nchoices,
+                          &maxlength, &secparam))
+        return NULL;
+
+    st = (struct state *) PyCapsule_GetPointer(py_state, NULL);
+    if (st == NULL)
+        return NULL;
+
+    tcols = py_ot_pack_columns(py_T, secparam, nchoices);
+    if (tcols == NULL)
+        goto cleanup;
+    out = (unsigned char *) ot_malloc(nchoices * maxlength);
+    if (out == NULL) {
+        (void) PyErr_NoMemory();
+        goto cleanup;
+    }
+
+    if (otext_iknp_recv_random(st, nchoices, maxlength, secparam, tcols, out))
+        PyErr_SetString(PyExc_RuntimeError,
+                        "random OT extension receive failed");
+    else
+        py_return = py_ot_unpack_msgs(out, nchoices, maxlength);
+
+ cleanup:
+    if (tcols)
+        ot_free(tcols);
+    if (out)
+        ot_free(out);
+
+    return py_return;
+}
+
+PyObject *
+py_otext_iknp_send_correlated(PyObject *self, PyObject *args)
+{
+    PyObject *py_state, *py_qt, *py_return = NULL;
+    struct state *st;
+    unsigned char *qcols = NULL;
+    block *out = NULL;
+    char *s, *delta;
+    int slen, deltalen;
+    long m;
+    unsigned int secparam;
+
+    if (!PyArg_ParseTuple(args, "OOs#ls#I", &py_state, &py_qt, &s, &slen, &m,
+                          &delta, &deltalen, &secparam))
+        return NULL;
+
+    st = (struct state *) PyCapsule_GetPointer(py_state, NULL);
+    if (st == NULL)
+        return NULL;
+
+    if ((unsigned int) slen != secparam / 8) {
+        PyErr_SetString(PyExc_ValueError, "len(s) != secparam / 8");
+        return NULL;
+    }
+    if (deltalen != sizeof(block)) {
+        PyErr_SetString(PyExc_ValueError, "len(delta) != 16");
+        return NULL;
+    }
+
+    qcols = py_ot_pack_columns(py_qt, secparam, m);
+    if (qcols == NULL)
+        goto cleanup;
+    out = (block *) ot_malloc(m * sizeof(block));
+    if (out == NULL) {
+        (void) PyErr_NoMemory();
+        goto cleanup;
+    }
+
+    if (otext_iknp_send_correlated(st, m, secparam, (unsigned char *) s, qcols,
+                                   _mm_loadu_si128((block *) delta), out))
+        PyErr_SetString(PyExc_RuntimeError,
+                        "correlated OT extension send failed");
+    else
+        py_return = py_ot_unpack_msgs((unsigned char *) out, m, sizeof(block));
+
+ cleanup:
+    if (qcols)
+        ot_free(qcols);
+    if (out)
+        ot_free(out);
+
+    return py_return;
 }
 
-static unsigned char *
-transpose(unsigned char *array, int nrows, int ncols)
+PyObject *
+py_otext_iknp_recv_correlated(PyObject *self, PyObject *args)
 {
-    unsigned char *tarray;
-    double start, end;
+    PyObject *py_state, *py_T, *py_choices, *py_return = NULL;
+    struct state *st;
+    unsigned char *choices = NULL, *tcols = NULL;
+    block *out = NULL;
+    long nchoices;
+    unsigned int secparam;
+
+    if (!PyArg_ParseTuple(args, "OOOI", &py_state, &py_choices, &py_T,
+                          &secparam))
+        return NULL;
+
+    st = (struct state *) PyCapsule_GetPointer(py_state, NULL);
+    if (st == NULL)
+        return NULL;
 
-    start = current_time();
-    tarray = (unsigned char *) malloc(nrows * ncols / 8);
-    if (tarray == NULL)
+    if ((nchoices = PySequence_Length(py_choices)) == -1)
         return NULL;
-    memset(tarray, '\0', nrows * ncols / 8);
 
-    for (int i = 0; i < ncols; ++i) {
-        for (int j = 0; j < nrows; ++j) {
-            unsigned char bit = get_bit(array, i * nrows + j);
-            set_bit(tarray, j * ncols + i, bit);
-        }
+    choices = py_ot_pack_choice_bits(py_choices, nchoices);
+    if (choices == NULL)
+        goto cleanup;
+    tcols = py_ot_pack_columns(py_T, secparam, nchoices);
+    if (tcols == NULL)
+        goto cleanup;
+    out = (block *) ot_malloc(nchoices * sizeof(block));
+    if (out == NULL) {
+        (void) PyErr_NoMemory();
+        goto cleanup;
     }
-    end = current_time();
-    fprintf(stderr, "transpose: %f\n", end - start);
 
-    return tarray;
+    if (otext_iknp_recv_correlated(st, choices, nchoices, secparam, tcols, out))
+        PyErr_SetString(PyExc_RuntimeError,
+                        "correlated OT extension receive failed");
+    else
+        py_return = py_ot_unpack_msgs((unsigned char *) out, nchoices,
+                                      sizeof(block));
+
+ cleanup:
+    if (choices)
+        ot_free(choices);
+    if (tcols)
+        ot_free(tcols);
+    if (out)
+        ot_free(out);
+
+    return py_return;
 }
 
 PyObject *
-otext_iknp_matrix_xor(PyObject *self, PyObject *args)
+py_otext_iknp_derandomize_send(PyObject *self, PyObject *args)
 {
-    PyObject *py_state, *py_matrix, *py_return = NULL;
+    PyObject *py_state, *py_msgs, *py_rand;
     struct state *st;
-    char *r, *xors;
-    Py_ssize_t rlen;
-    unsigned int nchoices, secparam;
+    unsigned char *msgs = NULL, *rand = NULL;
+    long m;
+    unsigned int maxlength;
+    int err = 0;
 
-    if (!PyArg_ParseTuple(args, "OOs#II", &py_state, &py_matrix, &r, &rlen,
-                          &nchoices, &secparam))
+    if (!PyArg_ParseTuple(args, "OOOI", &py_state, &py_msgs, &py_rand,
+                          &maxlength))
         return NULL;
 
     st = (struct state *) PyCapsule_GetPointer(py_state, NULL);
     if (st == NULL)
         return NULL;
 
-    assert(nchoices % 8 == 0);
-    nchoices /= 8;
+    if ((m = PySequence_Length(py_msgs)) == -1)
+        return NULL;
+
+    msgs = py_ot_pack_msgs(py_msgs, m, 2, maxlength);
+    if (msgs == NULL) {
+        err = 1;
+        goto cleanup;
+    }
+    rand = py_ot_pack_msgs(py_rand, m, 2, maxlength);
+    if (rand == NULL) {
+        err = 1;
+        goto cleanup;
+    }
+
+    err = otext_iknp_derandomize_send(st, msgs, m, maxlength, rand);
+    if (err)
+        PyErr_SetString(PyExc_RuntimeError, "derandomization send failed");
 
-    assert((int) rlen == (int) nchoices);
+ cleanup:
+    if (msgs)
+        ot_free(msgs);
+    if (rand)
+        ot_free(rand);
 
-    xors = (char *) malloc(sizeof(char) * nchoices);
-    if (xors == NULL)
+    if (err)
         return NULL;
+    else
+        Py_RETURN_NONE;
+}
 
-    py_return = PyTuple_New(secparam);
+PyObject *
+py_otext_iknp_derandomize_recv(PyObject *self, PyObject *args)
+{
+    PyObject *py_state, *py_choices, *py_rchoices, *py_rand, *py_return = NULL;
+    struct state *st;
+    unsigned char *choices = NULL, *rchoices = NULL, *rand = NULL, *out = NULL;
+    long nchoices;
+    unsigned int maxlength;
 
-    for (unsigned int i = 0; i < secparam; ++i) {
-        PyObject *tuple;
-        char *t;
-        Py_ssize_t tlen;
+    if (!PyArg_ParseTuple(args, "OOOOI", &py_state, &py_choices, &py_rchoices,
+                          &py_rand, &maxlength))
+        return NULL;
 
-        (void) PyBytes_AsStringAndSize(PySequence_GetItem(py_matrix, i), &t, &tlen);
-        assert(tlen == nchoices);
-        memcpy(xors, t, nchoices);
-        xorarray((unsigned char *) xors, nchoices, (unsigned char *) r, nchoices);
+    st = (struct state *) PyCapsule_GetPointer(py_state, NULL);
+    if (st == NULL)
+        return NULL;
 
-        tuple = PyTuple_New(2);
-        PyTuple_SetItem(tuple, 0, PySequence_GetItem(py_matrix, i));
-        PyTuple_SetItem(tuple, 1, PyString_FromStringAndSize(xors, nchoices));
+    if ((nchoices = PySequence_Length(py_choices)) == -1)
+        return NULL;
 
-        PyTuple_SetItem(py_return, i, tuple);
+    choices = py_ot_pack_choice_bits(py_choices, nchoices);
+    if (choices == NULL)
+        goto cleanup;
+    rchoices = py_ot_pack_choice_bits(py_rchoices, nchoices);
+    if (rchoices == NULL)
+        goto cleanup;
+    rand = py_ot_pack_strings(py_rand, nchoices, maxlength);
+    if (rand == NULL)
+        goto cleanup;
+    out = (unsigned char *) ot_malloc(nchoices * maxlength);
+    if (out == NULL) {
+        (void) PyErr_NoMemory();
+        goto cleanup;
     }
 
+    if (otext_iknp_derandomize_recv(st, choices, nchoices, maxlength,
+                                    rchoices, rand, out))
+        PyErr_SetString(PyExc_RuntimeError, "derandomization receive failed");
+    else
+        py_return = py_ot_unpack_msgs(out, nchoices, maxlength);
+
+ cleanup:
+    if (choices)
+        ot_free(choices);
+    if (rchoices)
+        ot_free(rchoices);
+    if (rand)
+        ot_free(rand);
+    if (out)
+        ot_free(out);
+
     return py_return;
 }
 
 PyObject *
-py_otext_iknp_send(PyObject *self, PyObject *args)
+py_otext_kos_send(PyObject *self, PyObject *args)
 {
     PyObject *py_state, *py_msgs, *py_qt;
     struct state *st;
     long m, err = 0;
     char *s;
-    unsigned char *array = NULL, *tarray = NULL;
+    unsigned char *msgs = NULL, *qcols = NULL;
     int slen;
     unsigned int msglength, secparam;
 
@@ -146,25 +426,33 @@ py_otext_iknp_send(PyObject *self, PyObject *args)
     if ((m = PySequence_Length(py_msgs)) == -1)
         return NULL;
 
-    array = to_array(py_qt, m, secparam);
-    if (array == NULL) {
+    if ((unsigned int) slen != secparam / 8) {
+        PyErr_SetString(PyExc_ValueError, "len(s) != secparam / 8");
+        return NULL;
+    }
+
+    msgs = py_ot_pack_msgs(py_msgs, m, 2, msglength);
+    if (msgs == NULL) {
         err = 1;
         goto cleanup;
     }
-    tarray = transpose(array, m, secparam);
-    if (tarray == NULL) {
+    /* Q also holds the padding rows */
+    qcols = py_ot_pack_columns(py_qt, secparam, m + OTEXT_KOS_PAD);
+    if (qcols == NULL) {
         err = 1;
         goto cleanup;
     }
 
-    err = otext_iknp_send(st, py_msgs, m, msglength, secparam / 8, s, slen,
-                          tarray, py_ot_msg_reader, py_ot_item_reader);
+    err = otext_kos_send(st, msgs, m, msglength, secparam,
+                         (unsigned char *) s, qcols);
+    if (err)
+        PyErr_SetString(PyExc_RuntimeError, "OT extension send failed");
 
  cleanup:
-    if (array)
-        free(array);
-    if (tarray)
-        free(tarray);
+    if (msgs)
+        ot_free(msgs);
+    if (qcols)
+        ot_free(qcols);
 
     if (err)
         return NULL;
@@ -173,55 +461,56 @@ py_otext_iknp_send(PyObject *self, PyObject *args)
 }
 
 PyObject *
-py_otext_iknp_recv(PyObject *self, PyObject *args)
+py_otext_kos_recv(PyObject *self, PyObject *args)
 {
     PyObject *py_state, *py_T, *py_choices, *py_return = NULL;
     struct state *st;
-    unsigned char *array = NULL, *tarray = NULL;
-    int nchoices, err = 0;
+    unsigned char *choices = NULL, *tcols = NULL, *out = NULL;
+    long nrows, nchoices;
     unsigned int maxlength, secparam;
 
     if (!PyArg_ParseTuple(args, "OOOII", &py_state, &py_choices, &py_T,
                           &maxlength, &secparam))
         return NULL;
 
-    // fprintf(stderr, "RUNNING\n");
-
     st = (struct state *) PyCapsule_GetPointer(py_state, NULL);
     if (st == NULL)
         return NULL;
 
-    if ((nchoices = PySequence_Length(py_choices)) == -1) {
-        err = 1;
-        goto cleanup;
+    /* 'choices' ends with OTEXT_KOS_PAD random padding bits */
+    if ((nrows = PySequence_Length(py_choices)) == -1)
+        return NULL;
+    if (nrows < OTEXT_KOS_PAD) {
+        PyErr_SetString(PyExc_ValueError, "missing padding choice bits");
+        return NULL;
     }
+    nchoices = nrows - OTEXT_KOS_PAD;
 
-    array = to_array(py_T, nchoices, secparam);
-    if (array == NULL) {
-        err = 1;
+    choices = py_ot_pack_choice_bits(py_choices, nrows);
+    if (choices == NULL)
         goto cleanup;
-    }
-    tarray = transpose(array, nchoices, secparam);
-    if (tarray == NULL) {
-        err = 1;
+    tcols = py_ot_pack_columns(py_T, secparam, nrows);
+    if (tcols == NULL)
+        goto cleanup;
+    out = (unsigned char *) ot_malloc(nchoices * maxlength);
+    if (out == NULL) {
+        (void) PyErr_NoMemory();
         goto cleanup;
     }
 
-    py_return = PyTuple_New(nchoices);
-
-    // fprintf(stderr, "ENTERING\n");
-
-    err = otext_iknp_recv(st, py_choices, nchoices, maxlength, secparam, tarray,
-                          py_return, py_ot_choice_reader, py_ot_msg_writer);
+    if (otext_kos_recv(st, choices, nchoices, maxlength, secparam, tcols,
+                       out))
+        PyErr_SetString(PyExc_RuntimeError, "OT extension receive failed");
+    else
+        py_return = py_ot_unpack_msgs(out, nchoices, maxlength);
 
  cleanup:
-    if (array)
-        free(array);
-    if (tarray)
-        free(tarray);
+    if (choices)
+        ot_free(choices);
+    if (tcols)
+        ot_free(tcols);
+    if (out)
+        ot_free(out);
 
-    if (err)
-        return NULL;
-    else
-        return py_return;
+    return py_return;
 }
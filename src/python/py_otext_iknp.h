@@ -7,9 +7,30 @@ PyObject *
 py_otext_iknp_send(PyObject *self, PyObject *args);
 
 PyObject *
-otext_iknp_matrix_xor(PyObject *self, PyObject *args);
+py_otext_iknp_recv(PyObject *self, PyObject *args);
 
 PyObject *
-py_otext_iknp_recv(PyObject *self, PyObject *args);
+py_otext_iknp_send_random(PyObject *self, PyObject *args);
+
+PyObject *
+py_otext_iknp_recv_random(PyObject *self, PyObject *args);
+
+PyObject *
+py_otext_iknp_send_correlated(PyObject *self, PyObject *args);
+
+PyObject *
+py_otext_iknp_recv_correlated(PyObject *self, PyObject *args);
+
+PyObject *
+py_otext_iknp_derandomize_send(PyObject *self, PyObject *args);
+
+PyObject *
+py_otext_iknp_derandomize_recv(PyObject *self, PyObject *args);
+
+PyObject *
+py_otext_kos_send(PyObject *self, PyObject *args);
+
+PyObject *
+py_otext_kos_recv(PyObject *self, PyObject *args);
 
 #endif
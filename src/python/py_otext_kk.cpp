@@ -0,0 +1,160 @@
+#include "py_otext_kk.h"
+#include "py_ot.h"
+
+#include "../otext_kk.h"
+#include "../utils.h"
+
+/*
+ * Returns the OTEXT_KK_CODEBITS columns of the codeword matrix of the
+ * receiver's choices as one string.
+ */
+PyObject *
+py_otext_kk_codewords(PyObject *self, PyObject *args)
+{
+    PyObject *py_choices, *py_return = NULL;
+    unsigned char *choices = NULL, *ccols = NULL;
+    long nchoices;
+    int N;
+
+    if (!PyArg_ParseTuple(args, "Oi", &py_choices, &N))
+        return NULL;
+
+    if ((nchoices = PySequence_Length(py_choices)) == -1)
+        return NULL;
+
+    choices = py_ot_pack_choice_bytes(py_choices, nchoices, N);
+    if (choices == NULL)
+        goto cleanup;
+    ccols = (unsigned char *) ot_malloc(OTEXT_KK_CODEBITS * (nchoices / 8));
+    if (ccols == NULL
+        || otext_kk_codeword_columns(ccols, choices, nchoices) == FAILURE) {
+        (void) PyErr_NoMemory();
+        goto cleanup;
+    }
+    py_return = PyString_FromStringAndSize((char *) ccols,
+                                           OTEXT_KK_CODEBITS * (nchoices / 8));
+
+ cleanup:
+    if (choices)
+        ot_free(choices);
+    if (ccols)
+        ot_free(ccols);
+
+    return py_return;
+}
+
+PyObject *
+py_otext_kk_send(PyObject *self, PyObject *args)
+{
+    PyObject *py_state, *py_msgs, *py_qt, *py_item;
+    struct state *st;
+    long m, N, err = 0;
+    char *s;
+    unsigned char *msgs = NULL, *qcols = NULL;
+    int slen;
+    unsigned int maxlength;
+
+    if (!PyArg_ParseTuple(args, "OOOs#I", &py_state, &py_msgs, &py_qt, &s,
+                          &slen, &maxlength))
+        return NULL;
+
+    st = (struct state *) PyCapsule_GetPointer(py_state, NULL);
+    if (st == NULL)
+        return NULL;
+
+    if ((m = PySequence_Length(py_msgs)) == -1)
+        return NULL;
+    if ((py_item = PySequence_GetItem(py_msgs, 0)) == NULL)
+        return NULL;
+    N = PySequence_Length(py_item);
+    Py_DECREF(py_item);
+    if (N == -1)
+        return NULL;
+    if (N < 2 || N > OTEXT_KK_MAXN) {
+        PyErr_SetString(PyExc_ValueError, "N must be in [2, 256]");
+        return NULL;
+    }
+    if (slen != OTEXT_KK_CODEBITS / 8) {
+        PyErr_SetString(PyExc_ValueError, "len(s) != 32");
+        return NULL;
+    }
+
+    msgs = py_ot_pack_msgs(py_msgs, m, N, maxlength);
+    if (msgs == NULL) {
+        err = 1;
+        goto cleanup;
+    }
+    qcols = py_ot_pack_columns(py_qt, OTEXT_KK_CODEBITS, m);
+    if (qcols == NULL) {
+        err = 1;
+        goto cleanup;
+    }
+
+    err = otext_kk_send(st, msgs, m, N, maxlength, (unsigned char *) s, qcols);
+    if (err)
+        PyErr_SetString(PyExc_RuntimeError, "OT extension send failed");
+
+ cleanup:
+    if (msgs)
+        ot_free(msgs);
+    if (qcols)
+        ot_free(qcols);
+
+    if (err)
+        return NULL;
+    else
+        Py_RETURN_NONE;
+}
+
+PyObject *
+py_otext_kk_recv(PyObject *self, PyObject *args)
+{
+    PyObject *py_state, *py_T, *py_choices, *py_return = NULL;
+    struct state *st;
+    unsigned char *choices = NULL, *tcols = NULL, *out = NULL;
+    long nchoices;
+    int N;
+    unsigned int maxlength;
+
+    if (!PyArg_ParseTuple(args, "OOOiI", &py_state, &py_choices, &py_T, &N,
+                          &maxlength))
+        return NULL;
+
+    st = (struct state *) PyCapsule_GetPointer(py_state, NULL);
+    if (st == NULL)
+        return NULL;
+
+    if (N < 2 || N > OTEXT_KK_MAXN) {
+        PyErr_SetString(PyExc_ValueError, "N must be in [2, 256]");
+        return NULL;
+    }
+    if ((nchoices = PySequence_Length(py_choices)) == -1)
+        return NULL;
+
+    choices = py_ot_pack_choice_bytes(py_choices, nchoices, N);
+    if (choices == NULL)
+        goto cleanup;
+    tcols = py_ot_pack_columns(py_T, OTEXT_KK_CODEBITS, nchoices);
+    if (tcols == NULL)
+        goto cleanup;
+    out = (unsigned char *) ot_malloc(nchoices * maxlength);
+    if (out == NULL) {
+        (void) PyErr_NoMemory();
+        goto cleanup;
+    }
+
+    if (otext_kk_recv(st, choices, nchoices, N, maxlength, tcols, out))
+        PyErr_SetString(PyExc_RuntimeError, "OT extension receive failed");
+    else
+        py_return = py_ot_unpack_msgs(out, nchoices, maxlength);
+
+ cleanup:
+    if (choices)
+        ot_free(choices);
+    if (tcols)
+        ot_free(tcols);
+    if (out)
+        ot_free(out);
+
+    return py_return;
+}
@@ -0,0 +1,15 @@
+#ifndef __OTLIB_PY_OTEXT_KK_H__
+#define __OTLIB_PY_OTEXT_KK_H__
+
+#include <Python.h>
+
+PyObject *
+py_otext_kk_codewords(PyObject *self, PyObject *args);
+
+PyObject *
+py_otext_kk_send(PyObject *self, PyObject *args);
+
+PyObject *
+py_otext_kk_recv(PyObject *self, PyObject *args);
+
+#endif
@@ -0,0 +1,139 @@
+#include "py_otext_nnob.h"
+#include "py_ot.h"
+
+#include "../otext_nnob.h"
+#include "../utils.h"
+
+static int
+check_secparam(unsigned int secparam)
+{
+    if (secparam == 0 || secparam > OTEXT_NNOB_MAXSECPARAM) {
+        PyErr_SetString(PyExc_ValueError, "unsupported secparam");
+        return FAILURE;
+    }
+    return SUCCESS;
+}
+
+PyObject *
+py_otext_nnob_ncols(PyObject *self, PyObject *args)
+{
+    unsigned int secparam;
+
+    if (!PyArg_ParseTuple(args, "I", &secparam))
+        return NULL;
+
+    if (check_secparam(secparam) == FAILURE)
+        return NULL;
+
+    return PyInt_FromLong(otext_nnob_ncols(secparam));
+}
+
+PyObject *
+py_otext_nnob_send(PyObject *self, PyObject *args)
+{
+    PyObject *py_state, *py_msgs, *py_qt;
+    struct state *st;
+    long m, err = 0;
+    char *s;
+    unsigned char *msgs = NULL, *qcols = NULL;
+    int slen;
+    unsigned int msglength, secparam, ncols;
+
+    if (!PyArg_ParseTuple(args, "OOOs#II", &py_state, &py_msgs,
+                          &py_qt, &s, &slen, &msglength, &secparam))
+        return NULL;
+
+    st = (struct state *) PyCapsule_GetPointer(py_state, NULL);
+    if (st == NULL)
+        return NULL;
+
+    if ((m = PySequence_Length(py_msgs)) == -1)
+        return NULL;
+
+    if (check_secparam(secparam) == FAILURE)
+        return NULL;
+    ncols = otext_nnob_ncols(secparam);
+    if ((unsigned int) slen != ncols / 8) {
+        PyErr_SetString(PyExc_ValueError, "len(s) != ncols / 8");
+        return NULL;
+    }
+
+    msgs = py_ot_pack_msgs(py_msgs, m, 2, msglength);
+    if (msgs == NULL) {
+        err = 1;
+        goto cleanup;
+    }
+    qcols = py_ot_pack_columns(py_qt, ncols, m);
+    if (qcols == NULL) {
+        err = 1;
+        goto cleanup;
+    }
+
+    err = otext_nnob_send(st, msgs, m, msglength, secparam,
+                          (unsigned char *) s, qcols);
+    if (err)
+        PyErr_SetString(PyExc_RuntimeError, "OT extension send failed");
+
+ cleanup:
+    if (msgs)
+        ot_free(msgs);
+    if (qcols)
+        ot_free(qcols);
+
+    if (err)
+        return NULL;
+    else
+        Py_RETURN_NONE;
+}
+
+PyObject *
+py_otext_nnob_recv(PyObject *self, PyObject *args)
+{
+    PyObject *py_state, *py_T, *py_choices, *py_return = NULL;
+    struct state *st;
+    unsigned char *choices = NULL, *tcols = NULL, *out = NULL;
+    long nchoices;
+    unsigned int maxlength, secparam;
+
+    if (!PyArg_ParseTuple(args, "OOOII", &py_state, &py_choices, &py_T,
+                          &maxlength, &secparam))
+        return NULL;
+
+    st = (struct state *) PyCapsule_GetPointer(py_state, NULL);
+    if (st == NULL)
+        return NULL;
+
+    if ((nchoices = PySequence_Length(py_choices)) == -1)
+        return NULL;
+
+    if (check_secparam(secparam) == FAILURE)
+        return NULL;
+
+    choices = py_ot_pack_choice_bits(py_choices, nchoices);
+    if (choices == NULL)
+        goto cleanup;
+    tcols = py_ot_pack_columns(py_T, otext_nnob_ncols(secparam), nchoices);
+    if (tcols == NULL)
+        goto cleanup;
+    out = (unsigned char *) ot_malloc(nchoices * maxlength);
+    if (out == NULL) {
+        (void) PyErr_NoMemory();
+        goto cleanup;
+    }
+
+    if (otext_nnob_recv(st, choices, nchoices, maxlength, secparam, tcols,
+                        out))
+        PyErr_SetString(PyExc_RuntimeError, "OT extension receive failed");
+    else
+        py_return = py_ot_unpack_msgs(out, nchoices, maxlength);
+
+ cleanup:
+    if (choices)
+        ot_free(choices);
+    if (tcols)
+        ot_free(tcols);
+    if (out)
+        ot_free(out);
+
+    return py_return;
+}
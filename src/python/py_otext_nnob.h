@@ -0,0 +1,15 @@
+#ifndef __OTLIB_PY_OTEXT_NNOB_H__
+#define __OTLIB_PY_OTEXT_NNOB_H__
+
+#include <Python.h>
+
+PyObject *
+py_otext_nnob_ncols(PyObject *self, PyObject *args);
+
+PyObject *
+py_otext_nnob_send(PyObject *self, PyObject *args);
+
+PyObject *
+py_otext_nnob_recv(PyObject *self, PyObject *args);
+
+#endif
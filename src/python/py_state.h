@@ -9,4 +9,7 @@ py_state_init(PyObject *self, PyObject *args);
 PyObject *
 py_state_cleanup(PyObject *self, PyObject *args);
 
+PyObject *
+py_state_random_bytes(PyObject *self, PyObject *args);
+
 #endif
@@ -1,11 +1,9 @@
-#include <Python.h>
-
-#include "net.h"
 #include "state.h"
+#include "net.h"
 #include "utils.h"
 
-#include <fcntl.h>
 #include <netdb.h>
+#include <string.h>
 #include <unistd.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
@@ -17,60 +15,104 @@ static const char *ifcp1024 = "B10B8F96A080E01DDE92DE5EAE5D54EC52C99FBCFB06A3C69
 static const char *ifcg1024 = "A4D1CBD5C3FD34126765A442EFB99905F8104DD258AC507FD6406CFF14266D31266FEA1E5C41564B777E690F5504F213160217B4B01B886A5E91547F9E2749F4D7FBD7D3B9A92EE1909D0D2263F80A76A6A24C087A091F531DBF0A0169B6A28AD662A4D18E73AFA32D779D5918D08BC8858F4DCEF97C2A24855E6EEB22B3B2E5";
 static const char *ifcq1024 = "F518AA8781A8DF278ABA4E7D64B7CB9D49462353";
 
-#define RANDFILE "/dev/urandom"
-
-static int
-state_initialize(struct state *s, long length)
+int
+state_initialize(struct state *s, long length, unsigned int nthreads)
 {
-    int error = 0, file;
-    unsigned long seed;
+    int error = 0;
 
     mpz_init_set_str(s->p.p, ifcp1024, 16);
     mpz_init_set_str(s->p.g, ifcg1024, 16);
     mpz_init_set_str(s->p.q, ifcq1024, 16);
+    if (fbtable_init(&s->p.gtab, s->p.g, s->p.p,
+                     mpz_sizeinbase(s->p.q, 2)) == FAILURE) {
+        (void) fprintf(stderr, "Error building table for g\n");
+        error = 1;
+    }
     s->sockfd = -1;
     s->serverfd = -1;
     s->length = length;
+    (void) memset(&s->ch, '\0', sizeof s->ch);
+    AES_set_fixed_key(&s->aeskey);
+    for (int i = 0; i < GROUP_NTYPES; ++i) {
+        if (group_init(&s->groups[i], (enum group_type) i, &s->p) == FAILURE) {
+            (void) fprintf(stderr, "Error initializing group %d\n", i);
+            error = 1;
+        }
+    }
+    if (pvw_crs_init(&s->pvw, &s->p) == FAILURE) {
+        (void) fprintf(stderr, "Error setting up PVW CRS\n");
+        error = 1;
+    }
+    s->pool = threadpool_create(nthreads);
+    if (s->pool == NULL) {
+        (void) fprintf(stderr, "Error creating thread pool\n");
+        error = 1;
+    }
 
-    /* seed random number generator */
-    if ((file = open(RANDFILE, O_RDONLY)) == -1) {
-        (void) fprintf(stderr, "Error opening %s\n", RANDFILE);
+    /* seed the random generator with a fresh 128-bit key */
+    if (prg_init(&s->p.rnd, NULL) == FAILURE) {
+        (void) fprintf(stderr, "Error seeding random generator\n");
         error = 1;
+    }
+    return error;
+}
+
+int
+state_connect(struct state *s, const char *host, const char *port,
+              int isserver)
+{
+    if (isserver) {
+        struct sockaddr_storage their_addr;
+        socklen_t sin_size = sizeof their_addr;
+        char addr[INET6_ADDRSTRLEN];
+
+        s->serverfd = init_server(host, port);
+        if (s->serverfd == -1) {
+            (void) fprintf(stderr, "server initialization failed\n");
+            return FAILURE;
+        }
+        s->sockfd = accept(s->serverfd, (struct sockaddr *) &their_addr,
+                           &sin_size);
+        if (s->sockfd == -1) {
+            perror("accept");
+            return FAILURE;
+        }
+
+        inet_ntop(their_addr.ss_family,
+                  get_in_addr((struct sockaddr *) &their_addr),
+                  addr, sizeof addr);
+        (void) fprintf(stderr, "server: got connection from %s\n", addr);
     } else {
-        if (read(file, &seed, sizeof seed) == -1) {
-            (void) fprintf(stderr, "Error reading from %s\n", RANDFILE);
-            (void) close(file);
-            error = 1;
+        s->sockfd = init_client(host, port);
+        if (s->sockfd == -1) {
+            (void) fprintf(stderr, "client initialization failed\n");
+            return FAILURE;
         }
     }
-    if (!error) {
-        fprintf(stderr, "Seed = %lu\n", seed);
-        gmp_randinit_default(s->p.rnd);
-        gmp_randseed_ui(s->p.rnd, seed);
-        (void) close(file);
+
+    if (channel_init(&s->ch, s->sockfd, CHANNEL_BUFSIZE) == -1) {
+        (void) fprintf(stderr, "channel initialization failed\n");
+        return FAILURE;
     }
-    return error;
+
+    return SUCCESS;
 }
 
-static void
+void
 state_cleanup(struct state *s)
 {
-    mpz_clears(s->p.p, s->p.g, s->p.q, NULL);
-    gmp_randclear(s->p.rnd);
-    if (s->sockfd != -1)
-        close(s->sockfd);
+    if (s->pool)
+        threadpool_destroy(s->pool);
+    channel_cleanup(&s->ch);
     if (s->serverfd != -1)
         close(s->serverfd);
-    free(s);
-}
-
-static void
-state_destructor(PyObject *self)
-{
-    struct state *s;
+    if (s->sockfd != -1)
+        close(s->sockfd);
 
-    s = (struct state *) PyCapsule_GetPointer(self, NULL);
-    if (s) {
-        state_cleanup(s);
-    }
+    for (int i = 0; i < GROUP_NTYPES; ++i)
+        group_cleanup(&s->groups[i]);
+    pvw_crs_cleanup(&s->pvw);
+    fbtable_clear(&s->p.gtab);
+    mpz_clears(s->p.p, s->p.g, s->p.q, NULL);
+    free(s);
 }
@@ -3,15 +3,46 @@
 
 #include <gmp.h>
 
+#include "aes.h"
 #include "gmputils.h"
+#include "group.h"
+#include "net.h"
+#include "pvw_crs.h"
+#include "threadpool.h"
 
 struct state {
     struct params p;
     long length;
     int sockfd;
     int serverfd;
+    struct channel ch;
+    AES_KEY aeskey;             /* fixed-key hash permutation */
+    struct threadpool *pool;    /* workers for OT extension */
+    struct group groups[GROUP_NTYPES]; /* groups for the base OTs */
+    struct pvw_crs pvw;         /* CRS for PVW OT */
 };
 
 extern const unsigned int field_size;
 
+/*
+ * Initializes the group parameters, randomness and hash key of 's', and starts
+ * 'nthreads' worker threads.
+ */
+int
+state_initialize(struct state *s, long length, unsigned int nthreads);
+
+/*
+ * Connects 's' to the other party, either by listening on 'host':'port' and
+ * accepting one connection ('isserver' nonzero) or by connecting to it.
+ */
+int
+state_connect(struct state *s, const char *host, const char *port,
+              int isserver);
+
+/*
+ * Closes all connections and frees 's'.
+ */
+void
+state_cleanup(struct state *s);
+
 #endif
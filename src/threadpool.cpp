@@ -0,0 +1,186 @@
+#include "threadpool.h"
+
+#include "utils.h"
+
+struct job {
+    threadpool_fn fn;
+    void *arg;
+    struct job *next;
+};
+
+struct threadpool {
+    pthread_mutex_t lock;
+    pthread_cond_t work;        /* signaled when a job is queued */
+    pthread_cond_t idle;        /* signaled when the last job finishes */
+    struct job *head;
+    struct job *tail;
+    unsigned int pending;       /* jobs queued or running */
+    int shutdown;
+    unsigned int nthreads;
+    pthread_t *threads;
+};
+
+static void *
+threadpool_worker(void *arg)
+{
+    struct threadpool *pool = (struct threadpool *) arg;
+
+    for (;;) {
+        struct job *job;
+
+        pthread_mutex_lock(&pool->lock);
+        while (pool->head == NULL && !pool->shutdown)
+            pthread_cond_wait(&pool->work, &pool->lock);
+        if (pool->head == NULL) {
+            pthread_mutex_unlock(&pool->lock);
+            return NULL;
+        }
+        job = pool->head;
+        pool->head = job->next;
+        if (pool->head == NULL)
+            pool->tail = NULL;
+        pthread_mutex_unlock(&pool->lock);
+
+        job->fn(job->arg);
+        free(job);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->pending == 0)
+            pthread_cond_broadcast(&pool->idle);
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+struct threadpool *
+threadpool_create(unsigned int nthreads)
+{
+    struct threadpool *pool;
+
+    pool = (struct threadpool *) calloc(1, sizeof(struct threadpool));
+    if (pool == NULL)
+        return NULL;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work, NULL);
+    pthread_cond_init(&pool->idle, NULL);
+
+    if (nthreads > 0) {
+        pool->threads = (pthread_t *) calloc(nthreads, sizeof(pthread_t));
+        if (pool->threads == NULL) {
+            threadpool_destroy(pool);
+            return NULL;
+        }
+    }
+    for (unsigned int i = 0; i < nthreads; ++i) {
+        if (pthread_create(&pool->threads[i], NULL, threadpool_worker,
+                           pool) != 0) {
+            threadpool_destroy(pool);
+            return NULL;
+        }
+        pool->nthreads++;
+    }
+    return pool;
+}
+
+void
+threadpool_destroy(struct threadpool *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = 1;
+    pthread_cond_broadcast(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (unsigned int i = 0; i < pool->nthreads; ++i)
+        pthread_join(pool->threads[i], NULL);
+
+    pthread_cond_destroy(&pool->idle);
+    pthread_cond_destroy(&pool->work);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->threads);
+    free(pool);
+}
+
+unsigned int
+threadpool_nthreads(const struct threadpool *pool)
+{
+    return pool->nthreads;
+}
+
+int
+threadpool_add_job(struct threadpool *pool, threadpool_fn fn, void *arg)
+{
+    struct job *job;
+
+    if (pool->nthreads == 0) {
+        fn(arg);
+        return SUCCESS;
+    }
+
+    job = (struct job *) malloc(sizeof(struct job));
+    if (job == NULL)
+        return FAILURE;
+    job->fn = fn;
+    job->arg = arg;
+    job->next = NULL;
+
+    pthread_mutex_lock(&pool->lock);
+    if (pool->tail)
+        pool->tail->next = job;
+    else
+        pool->head = job;
+    pool->tail = job;
+    pool->pending++;
+    pthread_cond_signal(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+
+    return SUCCESS;
+}
+
+void
+threadpool_wait(struct threadpool *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    while (pool->pending > 0)
+        pthread_cond_wait(&pool->idle, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void
+completion_init(struct completion *c)
+{
+    pthread_mutex_init(&c->lock, NULL);
+    pthread_cond_init(&c->cond, NULL);
+    c->done = 0;
+}
+
+void
+completion_cleanup(struct completion *c)
+{
+    pthread_cond_destroy(&c->cond);
+    pthread_mutex_destroy(&c->lock);
+}
+
+void
+completion_reset(struct completion *c)
+{
+    pthread_mutex_lock(&c->lock);
+    c->done = 0;
+    pthread_mutex_unlock(&c->lock);
+}
+
+void
+completion_signal(struct completion *c)
+{
+    pthread_mutex_lock(&c->lock);
+    c->done = 1;
+    pthread_cond_broadcast(&c->cond);
+    pthread_mutex_unlock(&c->lock);
+}
+
+void
+completion_wait(struct completion *c)
+{
+    pthread_mutex_lock(&c->lock);
+    while (!c->done)
+        pthread_cond_wait(&c->cond, &c->lock);
+    pthread_mutex_unlock(&c->lock);
+}
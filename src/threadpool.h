@@ -0,0 +1,57 @@
+#ifndef __OTLIB_THREADPOOL_H__
+#define __OTLIB_THREADPOOL_H__
+
+#include <pthread.h>
+
+struct threadpool;
+
+typedef void (*threadpool_fn)(void *arg);
+
+/*
+ * Creates a pool of 'nthreads' workers.  With 'nthreads' equal to zero, jobs
+ * run synchronously in the caller of threadpool_add_job().
+ */
+struct threadpool *
+threadpool_create(unsigned int nthreads);
+
+void
+threadpool_destroy(struct threadpool *pool);
+
+unsigned int
+threadpool_nthreads(const struct threadpool *pool);
+
+int
+threadpool_add_job(struct threadpool *pool, threadpool_fn fn, void *arg);
+
+/*
+ * Blocks until all jobs added so far have finished.
+ */
+void
+threadpool_wait(struct threadpool *pool);
+
+/*
+ * One-shot completion flag, used to hand results from a job back to the
+ * thread that submitted it (e.g., to write chunks to the network in order).
+ */
+struct completion {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int done;
+};
+
+void
+completion_init(struct completion *c);
+
+void
+completion_cleanup(struct completion *c);
+
+void
+completion_reset(struct completion *c);
+
+void
+completion_signal(struct completion *c);
+
+void
+completion_wait(struct completion *c);
+
+#endif
@@ -0,0 +1,161 @@
+/*
+ * Bit-matrix transposition using SSE2 movemask.
+ *
+ * The main kernel works on 16 x 128 bit blocks: it loads 16 bytes from each of
+ * 16 rows, transposes the bytes with unpack instructions so that each register
+ * holds the same byte of all 16 rows, and then peels off one output row per
+ * movemask.  On CPUs with AVX2, two such blocks are combined so that each
+ * movemask produces 32 bits.  Columns are processed in blocks of
+ * TRANSPOSE_BLOCK bits so that the input and output working sets stay in L1.
+ */
+#include "transpose.h"
+
+#include "cpu.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include <emmintrin.h>
+#include <immintrin.h>
+
+#define TRANSPOSE_BLOCK 1024    /* columns processed per cache block */
+
+#define IN(r, c) (in + (r) * instride + (c) / 8)
+#define OUT(r, c) (out + (r) * outstride + (c) / 8)
+
+/*
+ * Loads 16 bytes from each of the 16 rows starting at row 'r' and column 'c'
+ * and transposes them so that v[b] holds byte b of every row.  Rows are
+ * reversed within each group of 8 so that the most-significant bit of each
+ * output byte corresponds to the lowest row index.
+ */
+static inline void
+load_16x16(__m128i *v, const unsigned char *in, size_t instride,
+           size_t r, size_t c)
+{
+    __m128i x[16], s1[16], s2[16], s3[16];
+
+    for (int k = 0; k < 16; ++k) {
+        x[k] = _mm_loadu_si128((const __m128i *) IN(r + (k & 8) + 7 - (k & 7), c));
+    }
+    for (int i = 0; i < 8; ++i) {
+        s1[i] = _mm_unpacklo_epi8(x[2 * i], x[2 * i + 1]);
+        s1[i + 8] = _mm_unpackhi_epi8(x[2 * i], x[2 * i + 1]);
+    }
+    for (int h = 0; h < 2; ++h) {
+        for (int p = 0; p < 4; ++p) {
+            s2[8 * h + p] = _mm_unpacklo_epi16(s1[8 * h + 2 * p],
+                                               s1[8 * h + 2 * p + 1]);
+            s2[8 * h + 4 + p] = _mm_unpackhi_epi16(s1[8 * h + 2 * p],
+                                                   s1[8 * h + 2 * p + 1]);
+        }
+    }
+    for (int g = 0; g < 4; ++g) {
+        for (int o = 0; o < 2; ++o) {
+            s3[4 * g + o] = _mm_unpacklo_epi32(s2[4 * g + 2 * o],
+                                               s2[4 * g + 2 * o + 1]);
+            s3[4 * g + 2 + o] = _mm_unpackhi_epi32(s2[4 * g + 2 * o],
+                                                   s2[4 * g + 2 * o + 1]);
+        }
+    }
+    for (int f = 0; f < 8; ++f) {
+        v[2 * f] = _mm_unpacklo_epi64(s3[2 * f], s3[2 * f + 1]);
+        v[2 * f + 1] = _mm_unpackhi_epi64(s3[2 * f], s3[2 * f + 1]);
+    }
+}
+
+static void
+transpose_16x128(unsigned char *out, size_t outstride,
+                 const unsigned char *in, size_t instride, size_t r, size_t c)
+{
+    __m128i v[16];
+
+    load_16x16(v, in, instride, r, c);
+    for (int b = 0; b < 16; ++b) {
+        for (int i = 0; i < 8; ++i) {
+            uint16_t bits = (uint16_t) _mm_movemask_epi8(v[b]);
+            (void) memcpy(OUT(c + 8 * b + i, r), &bits, sizeof bits);
+            v[b] = _mm_slli_epi64(v[b], 1);
+        }
+    }
+}
+
+__attribute__((target("avx2")))
+static void
+transpose_32x128(unsigned char *out, size_t outstride,
+                 const unsigned char *in, size_t instride, size_t r, size_t c)
+{
+    __m128i lo[16], hi[16];
+
+    load_16x16(lo, in, instride, r, c);
+    load_16x16(hi, in, instride, r + 16, c);
+    for (int b = 0; b < 16; ++b) {
+        __m256i v = _mm256_set_m128i(hi[b], lo[b]);
+        for (int i = 0; i < 8; ++i) {
+            uint32_t bits = (uint32_t) _mm256_movemask_epi8(v);
+            (void) memcpy(OUT(c + 8 * b + i, r), &bits, sizeof bits);
+            v = _mm256_slli_epi64(v, 1);
+        }
+    }
+}
+
+/*
+ * Handles the rows and columns not covered by the wide kernels, 8 x 8 bits at
+ * a time.
+ */
+static void
+transpose_8x8(unsigned char *out, size_t outstride,
+              const unsigned char *in, size_t instride,
+              size_t r0, size_t r1, size_t c0, size_t c1)
+{
+    for (size_t r = r0; r < r1; r += 8) {
+        for (size_t c = c0; c < c1; c += 8) {
+            unsigned char tmp[16];
+            __m128i v;
+
+            (void) memset(tmp, '\0', sizeof tmp);
+            for (int k = 0; k < 8; ++k) {
+                tmp[k] = *IN(r + 7 - k, c);
+            }
+            v = _mm_loadu_si128((__m128i *) tmp);
+            for (int i = 0; i < 8; ++i) {
+                *OUT(c + i, r) = (unsigned char) _mm_movemask_epi8(v);
+                v = _mm_slli_epi64(v, 1);
+            }
+        }
+    }
+}
+
+void
+bit_transpose_strided(unsigned char *out, size_t outstride,
+                      const unsigned char *in, size_t instride,
+                      size_t nrows, size_t ncols)
+{
+    const int avx2 = cpu_has(CPU_AVX2);
+    size_t wcols = ncols - ncols % 128;
+
+    for (size_t cb = 0; cb < wcols; cb += TRANSPOSE_BLOCK) {
+        size_t ce = cb + TRANSPOSE_BLOCK < wcols ? cb + TRANSPOSE_BLOCK : wcols;
+        size_t r = 0;
+
+        for (; avx2 && r + 32 <= nrows; r += 32) {
+            for (size_t c = cb; c < ce; c += 128) {
+                transpose_32x128(out, outstride, in, instride, r, c);
+            }
+        }
+        for (; r + 16 <= nrows; r += 16) {
+            for (size_t c = cb; c < ce; c += 128) {
+                transpose_16x128(out, outstride, in, instride, r, c);
+            }
+        }
+        transpose_8x8(out, outstride, in, instride, r, nrows, cb, ce);
+    }
+    transpose_8x8(out, outstride, in, instride, 0, nrows, wcols, ncols);
+}
+
+void
+bit_transpose(unsigned char *out, const unsigned char *in,
+              size_t nrows, size_t ncols)
+{
+    bit_transpose_strided(out, nrows / 8, in, ncols / 8, nrows, ncols);
+}
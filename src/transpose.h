@@ -0,0 +1,27 @@
+#ifndef __OTLIB_TRANSPOSE_H__
+#define __OTLIB_TRANSPOSE_H__
+
+#include <stddef.h>
+
+/*
+ * Transposes the 'nrows' x 'ncols' bit matrix 'in' into the 'ncols' x 'nrows'
+ * bit matrix 'out'.  Both matrices are stored row by row, with the bits of
+ * each byte ordered most-significant bit first.  Both 'nrows' and 'ncols' must
+ * be multiples of 8.
+ */
+void
+bit_transpose(unsigned char *out, const unsigned char *in,
+              size_t nrows, size_t ncols);
+
+/*
+ * Same as bit_transpose(), except rows of 'in' are 'instride' bytes apart and
+ * rows of 'out' are 'outstride' bytes apart.  This allows transposing a
+ * sub-block of a larger matrix into a sub-block of another one; 'out' must not
+ * overlap 'in'.
+ */
+void
+bit_transpose_strided(unsigned char *out, size_t outstride,
+                      const unsigned char *in, size_t instride,
+                      size_t nrows, size_t ncols);
+
+#endif
@@ -0,0 +1,69 @@
+import os, random, time, unittest
+
+import otlib._otlib as _ot
+import otlib.ot_np as np
+import otlib.otext_iknp as iknp
+import otlib.otext_kos as kos
+
+NOTS = 1024
+MAXLENGTH = 18
+
+class CorruptReceiver(kos.OTExtReceiver):
+    """Sends a u column that does not match the choice vector: the seed k1
+    used for column 0 differs from the one given to the sender in the base
+    OTs, so u_0 = G(k0) ^ G(k1') ^ r."""
+    def _base_ot(self, choices, otmodule, secparam):
+        seeds = iknp.random_seeds(self._state, secparam)
+        otmodule.OTSender(self._state).send(seeds, iknp.SEEDLEN)
+        seeds[0] = (seeds[0][0], _ot.random_bytes(self._state, iknp.SEEDLEN))
+        r = iknp.binstr2bytes(''.join([str(c) for c in choices]))
+        return _ot.otext_expand_receive(self._state, seeds, r, secparam,
+                                        len(choices))
+
+_random_bits = iknp.random_bits
+
+def sender_random_bits(state, n):
+    # a corrupted column i only shows in Q when s_i = 1, so pin s_0
+    bits = _random_bits(state, n)
+    bits[0] = 1
+    return bits
+
+class TestKOS(unittest.TestCase):
+    def run_ot(self, receiver):
+        """Runs KOS with 'receiver' against an honest sender in a child
+        process, pinning s_0 = 1.  Returns whether the sender accepted, and
+        the receiver's output or None if it failed."""
+        port = repr(random.randint(20000, 60000))
+        msgs = tuple(('a%017d' % j, 'b%017d' % j) for j in xrange(NOTS))
+        pid = os.fork()
+        if pid == 0:
+            status = 1
+            try:
+                st = _ot.init('127.0.0.1', port, 80, True, 1)
+                iknp.random_bits = sender_random_bits
+                kos.OTExtSender(st).send(msgs, MAXLENGTH, np)
+                status = 0
+            finally:
+                os._exit(status)
+        time.sleep(0.3)
+        st = _ot.init('127.0.0.1', port, 80, False, 1)
+        choices = [random.randint(0, 1) for _ in xrange(NOTS)]
+        try:
+            r = receiver(st).receive(choices, MAXLENGTH, np)
+            r = all(r[j] == msgs[j][choices[j]] for j in xrange(NOTS))
+        except RuntimeError:
+            r = None
+        _, status = os.waitpid(pid, 0)
+        return os.WEXITSTATUS(status) == 0, r
+
+    def test_honest(self):
+        accepted, r = self.run_ot(kos.OTExtReceiver)
+        self.assertTrue(accepted)
+        self.assertTrue(r)
+
+    def test_corrupt_u_column(self):
+        accepted, _ = self.run_ot(CorruptReceiver)
+        self.assertFalse(accepted)
+
+if __name__ == '__main__':
+    unittest.main()
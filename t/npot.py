@@ -1,4 +1,64 @@
-import unittest
+import os, random, socket, time, unittest
+
+import otlib._otlib as _ot
+import otlib.ot_np as np
+
+NOTS = 16
+MAXLENGTH = 18
+FIELD_SIZE = 1024 / 8
+
+def recv_all(s, n):
+    buf = ''
+    while len(buf) < n:
+        data = s.recv(n - len(buf))
+        if not data:
+            break
+        buf += data
+    return buf
 
 class TestNPOT(unittest.TestCase):
-    pass
+    def run_sender(self, receiver):
+        """Runs an honest Naor-Pinkas sender in a child process and
+        'receiver(port, msgs)' against it.  Returns whether the sender
+        accepted, and what 'receiver' returned."""
+        port = random.randint(20000, 60000)
+        msgs = tuple(('a%017d' % j, 'b%017d' % j) for j in xrange(NOTS))
+        pid = os.fork()
+        if pid == 0:
+            status = 1
+            try:
+                st = _ot.init('127.0.0.1', repr(port), 80, True, 1)
+                np.OTSender(st).send(msgs, MAXLENGTH)
+                status = 0
+            finally:
+                os._exit(status)
+        time.sleep(0.3)
+        r = receiver(port, msgs)
+        _, status = os.waitpid(pid, 0)
+        return os.WEXITSTATUS(status) == 0, r
+
+    def test_honest(self):
+        def receiver(port, msgs):
+            st = _ot.init('127.0.0.1', repr(port), 80, False, 1)
+            choices = [random.randint(0, 1) for _ in xrange(NOTS)]
+            r = np.OTReceiver(st).receive(choices, MAXLENGTH)
+            return all(r[j] == msgs[j][choices[j]] for j in xrange(NOTS))
+        accepted, r = self.run_sender(receiver)
+        self.assertTrue(accepted)
+        self.assertTrue(r)
+
+    def test_zero_pk0(self):
+        # pk0 = 0 has no inverse; mapping it to 0 made the keys of both
+        # branches 0, so the receiver could strip both pads
+        def receiver(port, msgs):
+            s = socket.create_connection(('127.0.0.1', port))
+            # g^r and C_1
+            recv_all(s, 2 * FIELD_SIZE)
+            s.sendall('\0' * (NOTS * FIELD_SIZE))
+            recv_all(s, NOTS * 2 * MAXLENGTH)
+            s.close()
+        accepted, _ = self.run_sender(receiver)
+        self.assertFalse(accepted)
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,56 @@
+import os, random, socket, time, unittest
+
+import otlib._otlib as _ot
+import otlib.ot_pvw as pvw
+
+NOTS = 16
+MAXLENGTH = 18
+FIELD_SIZE = 1024 / 8
+
+def element(x):
+    # group elements go over the wire least significant byte first
+    return ''.join(chr((x >> (8 * i)) & 0xff) for i in xrange(FIELD_SIZE))
+
+class TestPVW(unittest.TestCase):
+    def run_sender(self, receiver):
+        """Runs an honest PVW sender in a child process and 'receiver' on the
+        socket 'receiver(port)' opens.  Returns whether the sender accepted,
+        and what 'receiver' returned."""
+        port = random.randint(20000, 60000)
+        msgs = tuple(('a%017d' % j, 'b%017d' % j) for j in xrange(NOTS))
+        pid = os.fork()
+        if pid == 0:
+            status = 1
+            try:
+                st = _ot.init('127.0.0.1', repr(port), 80, True, 1)
+                pvw.OTSender(st).send(msgs, MAXLENGTH)
+                status = 0
+            finally:
+                os._exit(status)
+        time.sleep(0.3)
+        r = receiver(port, msgs)
+        _, status = os.waitpid(pid, 0)
+        return os.WEXITSTATUS(status) == 0, r
+
+    def test_honest(self):
+        def receiver(port, msgs):
+            st = _ot.init('127.0.0.1', repr(port), 80, False, 1)
+            choices = [random.randint(0, 1) for _ in xrange(NOTS)]
+            r = pvw.OTReceiver(st).receive(choices, MAXLENGTH)
+            return all(r[j] == msgs[j][choices[j]] for j in xrange(NOTS))
+        accepted, r = self.run_sender(receiver)
+        self.assertTrue(accepted)
+        self.assertTrue(r)
+
+    def test_identity_key(self):
+        # with (gp, hp) = (1, 1) the key gp^s hp^t of both branches is 1, so
+        # the receiver could strip the pads of both branches
+        def receiver(port, msgs):
+            s = socket.create_connection(('127.0.0.1', port))
+            s.sendall(element(1) * (2 * NOTS))
+            s.close()
+        accepted, _ = self.run_sender(receiver)
+        self.assertFalse(accepted)
+
+if __name__ == '__main__':
+    unittest.main()